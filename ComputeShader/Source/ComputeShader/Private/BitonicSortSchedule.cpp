@@ -0,0 +1,187 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+#include "ComputeShaderPrivatePCH.h"
+#include "BitonicSortSchedule.h"
+
+static FBitonicSortPass MakeSortRowsPass(uint32 Level, uint32 LevelMask, uint32 MatrixHeight)
+{
+	FBitonicSortPass Pass;
+	Pass.Type = EBitonicPassType::SortRows;
+	Pass.Level = Level;
+	Pass.LevelMask = LevelMask;
+	Pass.Width = MatrixHeight;
+	Pass.Height = BITONIC_BLOCK_SIZE;
+	Pass.Stride = 0;
+	Pass.NumStrides = 0;
+	Pass.ThreadGroupsX = 1;
+	Pass.ThreadGroupsY = MatrixHeight;
+	return Pass;
+}
+
+static FBitonicSortPass MakeSortLocalPass(uint32 MatrixHeight)
+{
+	FBitonicSortPass Pass = MakeSortRowsPass(BITONIC_BLOCK_SIZE, BITONIC_BLOCK_SIZE, MatrixHeight);
+	Pass.Type = EBitonicPassType::SortLocal;
+	return Pass;
+}
+
+static FBitonicSortPass MakeTransposePass(uint32 Level, uint32 LevelMask, uint32 Width, uint32 Height)
+{
+	FBitonicSortPass Pass;
+	Pass.Type = EBitonicPassType::Transpose;
+	Pass.Level = Level;
+	Pass.LevelMask = LevelMask;
+	Pass.Width = Width;
+	Pass.Height = Height;
+	Pass.Stride = 0;
+	Pass.NumStrides = 0;
+	Pass.ThreadGroupsX = Width / TRANSPOSE_BLOCK_SIZE;
+	Pass.ThreadGroupsY = Height / TRANSPOSE_BLOCK_SIZE;
+	return Pass;
+}
+
+static FBitonicSortPass MakeMergeGlobalPass(uint32 LevelMask, uint32 Stride, uint32 NumStrides, uint32 MatrixHeight)
+{
+	FBitonicSortPass Pass;
+	Pass.Type = EBitonicPassType::MergeGlobal;
+	Pass.Level = Stride * 2;
+	Pass.LevelMask = LevelMask;
+	Pass.Width = BITONIC_BLOCK_SIZE;
+	Pass.Height = MatrixHeight;
+	Pass.Stride = Stride;
+	Pass.NumStrides = NumStrides;
+	Pass.ThreadGroupsX = 1;
+	Pass.ThreadGroupsY = MatrixHeight >> NumStrides;	// One thread per 2^NumStrides elements
+	return Pass;
+}
+
+// Merges the strides Level / 2 ... BITONIC_BLOCK_SIZE, up to BITONIC_MERGE_MAX_STRIDES of them per pass
+static void AddMergeGlobalPasses(uint32 Level, uint32 MatrixHeight, TArray<FBitonicSortPass>& OutPasses)
+{
+	for (uint32 Stride = Level / 2; Stride >= BITONIC_BLOCK_SIZE;)
+	{
+		const uint32 NumStrides = FMath::Min(BITONIC_MERGE_MAX_STRIDES, FMath::FloorLog2(Stride / BITONIC_BLOCK_SIZE) + 1);
+		OutPasses.Add(MakeMergeGlobalPass(Level, Stride, NumStrides, MatrixHeight));
+		Stride >>= NumStrides;
+	}
+}
+
+void BuildBitonicSortSchedule(uint32 NumElements, TArray<FBitonicSortPass>& OutPasses, EBitonicScheduleType ScheduleType)
+{
+	check(FMath::IsPowerOfTwo(NumElements) && NumElements >= BITONIC_BLOCK_SIZE && NumElements <= MAX_NUM_ELEMENTS);
+
+	const uint32 MatrixWidth = BITONIC_BLOCK_SIZE;
+	const uint32 MatrixHeight = NumElements / BITONIC_BLOCK_SIZE;
+
+	OutPasses.Reset();
+
+	// Sort the rows for the levels <= the block size, all in one dispatch
+	OutPasses.Add(MakeSortLocalPass(MatrixHeight));
+
+	// Then sort the rows and columns for the levels > than the block size
+	for (uint32 Level = (BITONIC_BLOCK_SIZE * 2); Level <= NumElements; Level = Level * 2)
+	{
+		// The transposed columns have to fit into a thread group, and there have to be enough rows for a transpose tile
+		if (ScheduleType == EBitonicScheduleType::Transpose && Level <= BITONIC_BLOCK_SIZE * BITONIC_BLOCK_SIZE && MatrixHeight >= TRANSPOSE_BLOCK_SIZE)
+		{
+			// Transpose. Sort the Columns. Transpose. Sort the Rows.
+			OutPasses.Add(MakeTransposePass(Level / BITONIC_BLOCK_SIZE, (Level & ~NumElements) / BITONIC_BLOCK_SIZE, MatrixWidth, MatrixHeight));
+			OutPasses.Add(MakeSortRowsPass(Level / BITONIC_BLOCK_SIZE, (Level & ~NumElements) / BITONIC_BLOCK_SIZE, MatrixHeight));
+			OutPasses.Add(MakeTransposePass(BITONIC_BLOCK_SIZE, Level, MatrixHeight, MatrixWidth));
+		}
+		else
+		{
+			// Compare-exchange the strides that don't fit into a thread group directly in device memory
+			AddMergeGlobalPasses(Level, MatrixHeight, OutPasses);
+		}
+
+		// Merge the strides < the block size of this level in the rows (local merge)
+		OutPasses.Add(MakeSortRowsPass(BITONIC_BLOCK_SIZE, Level, MatrixHeight));
+	}
+}
+
+FBitonicPassParameters GetBitonicPassParameters(const FBitonicSortPass& Pass)
+{
+	FBitonicPassParameters Parameters;
+	Parameters.Level = Pass.Level;
+	Parameters.LevelMask = Pass.LevelMask;
+	Parameters.Width = Pass.Width;
+	Parameters.Height = Pass.Height;
+	Parameters.Stride = Pass.Stride;
+	Parameters.NumStrides = Pass.NumStrides;
+	Parameters.Padding[0] = Parameters.Padding[1] = 0;
+	return Parameters;
+}
+
+FBitonicSortScheduleCost GetBitonicSortScheduleCost(const TArray<FBitonicSortPass>& Passes, uint32 NumElements, uint32 ElementSize)
+{
+	FBitonicSortScheduleCost Cost;
+	const uint64 DataSize = (uint64)NumElements * ElementSize;
+
+	// Every pass reads and writes all elements once (the merge passes only write swapped elements, so this is an upper bound for them)
+	for (const FBitonicSortPass& Pass : Passes)
+	{
+		Cost.NumDispatches++;
+		Cost.BytesRead += DataSize;
+		Cost.BytesWritten += DataSize;
+	}
+	return Cost;
+}
+
+/************************************************************************/
+/* Compares the dispatches and the memory traffic of both schedules for */
+/* the supported problem sizes (key/index pairs and float32 payload).   */
+/************************************************************************/
+static void BenchmarkBitonicSortSchedules()
+{
+	const uint32 KeyIndexSize = sizeof(uint32) * 2;
+	const uint32 PayloadSize = sizeof(uint32) + sizeof(FVector4) * 2;
+
+	TArray<FBitonicSortPass> Passes;
+	UE_LOG(LogConsoleResponse, Display, TEXT("%10s %12s %10s %14s %14s"), TEXT("Elements"), TEXT("Schedule"), TEXT("Dispatches"), TEXT("KeyIndex MB"), TEXT("Payload MB"));
+
+	for (uint32 NumElements = BITONIC_BLOCK_SIZE * 64; NumElements <= MAX_NUM_ELEMENTS; NumElements *= 4)
+	{
+		for (EBitonicScheduleType ScheduleType : { EBitonicScheduleType::Transpose, EBitonicScheduleType::GlobalMerge })
+		{
+			BuildBitonicSortSchedule(NumElements, Passes, ScheduleType);
+			const FBitonicSortScheduleCost KeyIndexCost = GetBitonicSortScheduleCost(Passes, NumElements, KeyIndexSize);
+			const FBitonicSortScheduleCost PayloadCost = GetBitonicSortScheduleCost(Passes, NumElements, PayloadSize);
+
+			UE_LOG(LogConsoleResponse, Display, TEXT("%10u %12s %10u %14.1f %14.1f"),
+				NumElements,
+				ScheduleType == EBitonicScheduleType::Transpose ? TEXT("Transpose") : TEXT("GlobalMerge"),
+				KeyIndexCost.NumDispatches,
+				(KeyIndexCost.BytesRead + KeyIndexCost.BytesWritten) / (1024.0 * 1024.0),
+				(PayloadCost.BytesRead + PayloadCost.BytesWritten) / (1024.0 * 1024.0));
+		}
+	}
+}
+
+static FAutoConsoleCommand BenchmarkBitonicSortSchedulesCommand(
+	TEXT("ComputeShader.BenchmarkBitonicSchedules"),
+	TEXT("Logs the dispatches and the memory traffic of the transpose and the global merge schedule of the bitonic sort"),
+	FConsoleCommandDelegate::CreateStatic(&BenchmarkBitonicSortSchedules));
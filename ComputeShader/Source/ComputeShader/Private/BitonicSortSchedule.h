@@ -0,0 +1,120 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Group sizes of the sorting kernels. These are passed to the shaders as defines (see ModifyCompilationEnvironment), so they only have to be changed here.
+const uint32 BITONIC_BLOCK_SIZE = 1024;
+const uint32 TRANSPOSE_BLOCK_SIZE = 16;
+
+// Largest supported (padded) problem size: 4096 * 4096 points
+const uint32 MAX_NUM_ELEMENTS = 16 * 1024 * 1024;
+
+// Number of consecutive global compare-exchange steps a merge pass combines (2^n elements per thread, kept in registers)
+const uint32 BITONIC_MERGE_MAX_STRIDES = 3;
+
+/************************************************************************/
+/* The kernels the bitonic sorting network is made of                   */
+/************************************************************************/
+enum class EBitonicPassType : uint8
+{
+	SortLocal,		// Sorts each row of BITONIC_BLOCK_SIZE elements for all levels up to the row size in groupshared memory
+	SortRows,		// Merges each row in groupshared memory: the strides < BITONIC_BLOCK_SIZE of one level
+	Transpose,		// Transposes the matrix of rows
+	MergeGlobal		// Up to BITONIC_MERGE_MAX_STRIDES compare-exchange steps in device memory (strides >= BITONIC_BLOCK_SIZE)
+};
+
+/************************************************************************/
+/* How the levels beyond BITONIC_BLOCK_SIZE are sorted                  */
+/************************************************************************/
+enum class EBitonicScheduleType : uint8
+{
+	// Transpose, sort the columns, transpose back, sort the rows (4 full read/write passes per level, up to 1M elements)
+	Transpose,
+	// Merge the strides >= BITONIC_BLOCK_SIZE directly in device memory, then sort the rows
+	GlobalMerge
+};
+
+/************************************************************************/
+/* One dispatch of the sorting network and the constants it needs       */
+/************************************************************************/
+struct FBitonicSortPass
+{
+	EBitonicPassType Type;
+	uint32 Level;
+	uint32 LevelMask;
+	uint32 Width;
+	uint32 Height;
+	uint32 Stride;
+	uint32 NumStrides;		// MergeGlobal: Stride, Stride / 2, ... (NumStrides steps)
+	uint32 ThreadGroupsX;
+	uint32 ThreadGroupsY;
+};
+
+/************************************************************************/
+/* Row of the pass table the kernels read their constants from, same    */
+/* layout as FBitonicPass in SortPasses.ush. The table is uploaded once */
+/* per schedule, each dispatch only selects its row by the pass index.  */
+/************************************************************************/
+struct FBitonicPassParameters
+{
+	uint32 Level;
+	uint32 LevelMask;
+	uint32 Width;
+	uint32 Height;
+	uint32 Stride;
+	uint32 NumStrides;
+	uint32 Padding[2];
+};
+
+FBitonicPassParameters GetBitonicPassParameters(const FBitonicSortPass& Pass);
+
+/************************************************************************/
+/* Plans the dispatches that sort NumElements (a power of two, at least */
+/* BITONIC_BLOCK_SIZE) values in descending order.                      */
+/* The problem is treated as a matrix with rows of BITONIC_BLOCK_SIZE   */
+/* elements, one thread group per row. A single local sort pass covers  */
+/* the levels up to the row size. The levels beyond the row size        */
+/* are sorted by transposing the matrix while the columns fit into a    */
+/* thread group (Transpose), larger strides are merged directly in      */
+/* device memory. GlobalMerge merges all large strides in device memory.*/
+/************************************************************************/
+void BuildBitonicSortSchedule(uint32 NumElements, TArray<FBitonicSortPass>& OutPasses, EBitonicScheduleType ScheduleType = EBitonicScheduleType::Transpose);
+
+/************************************************************************/
+/* Estimated cost of a schedule: dispatches and the device memory the   */
+/* passes read and write (worst case, every compare-exchange swaps).    */
+/************************************************************************/
+struct FBitonicSortScheduleCost
+{
+	uint32 NumDispatches = 0;
+	uint64 BytesRead = 0;
+	uint64 BytesWritten = 0;
+};
+
+/** @param ElementSize - Bytes moved per element, e.g. 8 for key/index pairs */
+FBitonicSortScheduleCost GetBitonicSortScheduleCost(const TArray<FBitonicSortPass>& Passes, uint32 NumElements, uint32 ElementSize);
@@ -0,0 +1,98 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+#include "ComputeShaderPrivatePCH.h"
+#include "ComputeShaderBatch.h"
+
+FComputeShaderBatch::FComputeShaderBatch(ERHIFeatureLevel::Type ShaderFeatureLevel)
+	: FeatureLevel(ShaderFeatureLevel)
+{
+	// The segmented keys need the GPU key/index sort
+	check(FeatureLevel >= ERHIFeatureLevel::SM5);
+}
+
+FComputeShaderBatch::~FComputeShaderBatch()
+{
+	// The render thread may still reference the sorter
+	if (ComputeShader.IsValid())
+		FlushRenderingCommands();
+}
+
+int32 FComputeShaderBatch::AddCloud(int32 NumPoints)
+{
+	check(IsInGameThread());
+	check(NumPoints > 0 && Segments.Num() < (int32)MAX_SORT_SEGMENTS);
+
+	//* Append the cloud behind the others */
+	FPointSegment Segment;
+	FMemory::Memzero(Segment);
+	Segment.Start = Segments.Num() > 0 ? Segments.Last().Start + Segments.Last().Count : 0;
+	Segment.Count = NumPoints;
+
+	const int32 TotalNumPoints = Segment.Start + Segment.Count;
+	if (!ComputeShader.IsValid()) {
+		ComputeShader = MakeUnique<FComputeShader>(1.0f, TotalNumPoints, FeatureLevel);
+		ComputeShader->SetSortMode(ESortMode::KeyIndex);
+	}
+	else {
+		// Keeps the points of the other clouds
+		ComputeShader->SetNumElements(TotalNumPoints);
+	}
+
+	Segments.Add(Segment);
+	CloudCamPos.Add(FVector4(0.0f, 0.0f, 0.0f, 0.0f));
+	CloudViewDir.Add(FVector4(0.0f, 0.0f, 0.0f, 0.0f));
+	ComputeShader->SetPointSegments(Segments);
+
+	return Segments.Num() - 1;
+}
+
+void FComputeShaderBatch::SetCloudPointData(int32 CloudIndex, const FVector4* PointPos, const FVector4* PointColors)
+{
+	ComputeShader->UpdatePointRange(Segments[CloudIndex].Start, Segments[CloudIndex].Count, PointPos, PointColors);
+}
+
+void FComputeShaderBatch::SetCloudCamera(int32 CloudIndex, const FVector4& CamPos, const FVector& ViewDirection)
+{
+	CloudCamPos[CloudIndex] = CamPos;
+	CloudViewDir[CloudIndex] = FVector4(ViewDirection.GetSafeNormal(), 0.0f);
+}
+
+void FComputeShaderBatch::Execute()
+{
+	if (ComputeShader.IsValid())
+		ComputeShader->ExecuteComputeShader(CloudCamPos.GetData(), CloudCamPos.Num(), CloudViewDir.GetData());
+}
+
+FPointCloudSortView FComputeShaderBatch::GetCloudView(int32 CloudIndex)
+{
+	FPointCloudSortView View;
+	View.PointPosTexture = ComputeShader->GetSortedPointPosTexture();
+	View.PointColorsTexture = ComputeShader->GetSortedPointColorsTexture();
+	View.FirstElement = Segments[CloudIndex].Start;
+	View.NumElements = Segments[CloudIndex].Count;
+	View.TextureHeight = View.PointPosTexture->GetSizeY();
+	return View;
+}
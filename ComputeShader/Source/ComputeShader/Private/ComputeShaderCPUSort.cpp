@@ -0,0 +1,185 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+
+#include "ComputeShaderPrivatePCH.h"
+#include "ComputeShaderCPUSort.h"
+#include "Async/ParallelFor.h"
+
+int32 FComputeShaderCPUSort::GetNumChunks(int32 Num)
+{
+	const int32 MaxChunks = FMath::Max(1, FPlatformMisc::NumberOfCoresIncludingHyperthreads());
+	return FMath::Clamp(Num / CPU_SORT_MIN_CHUNK_SIZE, 1, MaxChunks);
+}
+
+// Same as GetOrderedFloatBits in PointSortKey.ush: keeps the order of the floats when compared as uint, also for negative values
+static uint32 GetOrderedFloatBits(float Value)
+{
+	const uint32 Bits = *reinterpret_cast<const uint32*>(&Value);
+	return (Bits & 0x80000000) ? ~Bits : (Bits | 0x80000000);
+}
+
+void FComputeShaderCPUSort::GenerateSortKeys(const FVector4* PointPos, int32 NumPoints, const FVector4& CamPos, FSortKeyIndex* OutKeys, const FPointSortKey& SortKey, const FVector4& ViewDir, const FVector4* PointColors)
+{
+	check(SortKey.Type != ESortKeyType::Attribute || PointColors);
+
+	const VectorRegister Cam = VectorLoadFloat3_W0(&CamPos);
+	const VectorRegister Dir = VectorLoadFloat3_W0(&ViewDir);
+	const bool bSwizzle = SortKey.Swizzle == ESortKeySwizzle::YZX;
+	const bool bFrontToBack = SortKey.Order == ESortOrder::FrontToBack;
+	const int32 NumChunks = GetNumChunks(NumPoints);
+	const int32 ChunkSize = FMath::DivideAndRoundUp(NumPoints, NumChunks);
+
+	ParallelFor(NumChunks, [&](int32 Chunk)
+	{
+		const int32 Begin = Chunk * ChunkSize;
+		const int32 End = FMath::Min(Begin + ChunkSize, NumPoints);
+
+		for (int32 i = Begin; i < End; ++i)
+		{
+			// Mind the mapping of the positions: the shaders use pos.gbr by default
+			const VectorRegister Pos = VectorLoad(&PointPos[i]);
+			const VectorRegister Delta = VectorSubtract(bSwizzle ? VectorSwizzle(Pos, 1, 2, 0, 3) : Pos, Cam);
+
+			uint32 Key;
+			if (SortKey.Type == ESortKeyType::ViewDepth) {
+				float Depth;
+				VectorStoreFloat1(VectorDot3(Delta, Dir), &Depth);
+				Key = GetOrderedFloatBits(Depth);
+			}
+			else if (SortKey.Type == ESortKeyType::Attribute)
+				Key = GetOrderedFloatBits(PointColors[i].W);
+			else {
+				float DistanceSquared;
+				VectorStoreFloat1(VectorDot3(Delta, Delta), &DistanceSquared);
+				Key = *reinterpret_cast<const uint32*>(&DistanceSquared);
+			}
+			if (bFrontToBack)
+				Key = ~Key;
+
+			const bool bInvalid = PointPos[i].X == 0 && PointPos[i].Y == 0 && PointPos[i].Z == 0;
+			OutKeys[i].Key = bInvalid ? 0 : FMath::Max(Key, 1u);
+			OutKeys[i].Index = i;
+		}
+	});
+}
+
+void FComputeShaderCPUSort::ParallelRadixSort(FSortKeyIndex* InKeys, FSortKeyIndex* InScratch, int32 NumKeys)
+{
+	const int32 NumChunks = GetNumChunks(NumKeys);
+	const int32 ChunkSize = FMath::DivideAndRoundUp(NumKeys, NumChunks);
+
+	// Digit-major like the GPU counters: [Digit * NumChunks + Chunk]
+	TArray<uint32> Counters;
+	Counters.SetNumUninitialized(CPU_RADIX_SIZE * NumChunks);
+
+	FSortKeyIndex* Src = InKeys;
+	FSortKeyIndex* Dst = InScratch;
+
+	for (uint32 Pass = 0; Pass < CPU_RADIX_NUM_PASSES; ++Pass)
+	{
+		const uint32 Shift = Pass * CPU_RADIX_BITS;
+
+		// Histogram per chunk, the key is inverted to get a descending order
+		ParallelFor(NumChunks, [&](int32 Chunk)
+		{
+			uint32 Histogram[CPU_RADIX_SIZE] = { 0 };
+			const int32 End = FMath::Min((Chunk + 1) * ChunkSize, NumKeys);
+			for (int32 i = Chunk * ChunkSize; i < End; ++i)
+				Histogram[((~Src[i].Key) >> Shift) & (CPU_RADIX_SIZE - 1)]++;
+
+			for (uint32 Digit = 0; Digit < CPU_RADIX_SIZE; ++Digit)
+				Counters[Digit * NumChunks + Chunk] = Histogram[Digit];
+		});
+
+		// Skip passes in which all keys have the same digit (e.g. the high bits of nearby points)
+		bool bSingleDigit = false;
+		for (uint32 Digit = 0; Digit < CPU_RADIX_SIZE && !bSingleDigit; ++Digit)
+		{
+			uint32 Count = 0;
+			for (int32 Chunk = 0; Chunk < NumChunks; ++Chunk)
+				Count += Counters[Digit * NumChunks + Chunk];
+			bSingleDigit = Count == (uint32)NumKeys;
+		}
+		if (bSingleDigit)
+			continue;
+
+		FComputeShaderReference::RadixPrefixScan(Counters.GetData(), Counters.Num());
+
+		// Stable scatter, every chunk writes to its own output ranges
+		ParallelFor(NumChunks, [&](int32 Chunk)
+		{
+			uint32 Offsets[CPU_RADIX_SIZE];
+			for (uint32 Digit = 0; Digit < CPU_RADIX_SIZE; ++Digit)
+				Offsets[Digit] = Counters[Digit * NumChunks + Chunk];
+
+			const int32 End = FMath::Min((Chunk + 1) * ChunkSize, NumKeys);
+			for (int32 i = Chunk * ChunkSize; i < End; ++i)
+				Dst[Offsets[((~Src[i].Key) >> Shift) & (CPU_RADIX_SIZE - 1)]++] = Src[i];
+		});
+
+		Swap(Src, Dst);
+	}
+
+	if (Src != InKeys)
+		FMemory::Memcpy(InKeys, Src, sizeof(FSortKeyIndex) * NumKeys);
+}
+
+void FComputeShaderCPUSort::SortPoints(const FVector4* PointPos, const FVector4* PointColors, int32 NumPoints, int32 SizeX, int32 SizeY, const FVector4& CamPos, const FVector4& ViewDir, const FPointSortKey& SortKey)
+{
+	const int32 NumTexels = SizeX * SizeY;
+	check(NumPoints <= NumTexels);
+
+	Keys.SetNumUninitialized(NumPoints, false);
+	Scratch.SetNumUninitialized(NumPoints, false);
+	SortedPointPos.SetNumUninitialized(NumTexels, false);
+	SortedPointColors.SetNumUninitialized(NumTexels, false);
+
+	GenerateSortKeys(PointPos, NumPoints, CamPos, Keys.GetData(), SortKey, ViewDir, PointColors);
+	ParallelRadixSort(Keys.GetData(), Scratch.GetData(), NumPoints);
+
+	// Same column by column layout as the shaders: element i goes to texel (i / SizeY, i % SizeY)
+	const int32 NumChunks = GetNumChunks(NumTexels);
+	const int32 ChunkSize = FMath::DivideAndRoundUp(NumTexels, NumChunks);
+	ParallelFor(NumChunks, [&](int32 Chunk)
+	{
+		const int32 End = FMath::Min((Chunk + 1) * ChunkSize, NumTexels);
+		for (int32 i = Chunk * ChunkSize; i < End; ++i)
+		{
+			const int32 PointIndex = i < NumPoints ? Keys[i].Index : i;
+			const int32 Texel = (i % SizeY) * SizeX + i / SizeY;
+			SortedPointPos[Texel] = PointPos[PointIndex];
+			SortedPointColors[Texel] = PointColors[PointIndex];
+		}
+	});
+}
+
+void FComputeShaderCPUSort::Empty()
+{
+	Keys.Empty();
+	Scratch.Empty();
+	SortedPointPos.Empty();
+	SortedPointColors.Empty();
+}
@@ -0,0 +1,83 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ComputeShaderReference.h"
+#include "ComputeShaderDeclaration.h"
+
+// The CPU radix sort uses 8 bit digits, the counters of a chunk fit into the L1 cache easily
+const uint32 CPU_RADIX_BITS = 8;
+const uint32 CPU_RADIX_SIZE = 1 << CPU_RADIX_BITS;
+const uint32 CPU_RADIX_NUM_PASSES = 32 / CPU_RADIX_BITS;
+
+// Minimum number of points per ParallelFor task
+const int32 CPU_SORT_MIN_CHUNK_SIZE = 16 * 1024;
+
+/***************************************************************************/
+/* Sorts the points on the CPU, for feature levels without compute shaders */
+/* and for runs without a GPU. Uses all cores via ParallelFor. The result  */
+/* is in the same (column by column) layout as the output textures.        */
+/***************************************************************************/
+class COMPUTESHADER_API FComputeShaderCPUSort
+{
+public:
+	/************************************************************************/
+	/* Emits a (key, index) pair per point, same keys as the shaders (see   */
+	/* PointSortKey.ush): by default the squared distance compared as       */
+	/* integer, invalid (zero) points get the key 0 and end up at the end.  */
+	/* PointColors are only read by the attribute keys, ViewDir only by the */
+	/* view depth keys.                                                     */
+	/************************************************************************/
+	static void GenerateSortKeys(const FVector4* PointPos, int32 NumPoints, const FVector4& CamPos, FSortKeyIndex* OutKeys, const FPointSortKey& SortKey = FPointSortKey(), const FVector4& ViewDir = FVector4(0.0f, 0.0f, 0.0f, 0.0f), const FVector4* PointColors = nullptr);
+
+	/************************************************************************/
+	/* Stable LSD radix sort in descending key order. Scratch has to hold   */
+	/* as many elements as Keys, the result always ends up in Keys.         */
+	/************************************************************************/
+	static void ParallelRadixSort(FSortKeyIndex* Keys, FSortKeyIndex* Scratch, int32 NumKeys);
+
+	/************************************************************************/
+	/* Sorts the first NumPoints points by the key and writes them to       */
+	/* the output arrays (NumTexels elements, texel order of a texture with */
+	/* the given size). The texels behind NumPoints get the padding points. */
+	/************************************************************************/
+	void SortPoints(const FVector4* PointPos, const FVector4* PointColors, int32 NumPoints, int32 SizeX, int32 SizeY, const FVector4& CamPos, const FVector4& ViewDir, const FPointSortKey& SortKey);
+
+	const TArray<FVector4>& GetSortedPointPos() const { return SortedPointPos; }
+	const TArray<FVector4>& GetSortedPointColors() const { return SortedPointColors; }
+
+	// Frees the working memory
+	void Empty();
+
+private:
+	static int32 GetNumChunks(int32 Num);
+
+	TArray<FSortKeyIndex> Keys;
+	TArray<FSortKeyIndex> Scratch;
+	TArray<FVector4> SortedPointPos;
+	TArray<FVector4> SortedPointColors;
+};
@@ -42,15 +42,24 @@ FComputeShaderDeclaration::FComputeShaderDeclaration(const ShaderMetaType::Compi
 	OutputColorTexture.Bind(Initializer.ParameterMap, TEXT("OutputColorTexture"));
 	PointColorData.Bind(Initializer.ParameterMap, TEXT("PointColorData"));
 	PointColorDataBuffer.Bind(Initializer.ParameterMap, TEXT("PointColorDataBuffer"));
+	PointKeys.Bind(Initializer.ParameterMap, TEXT("PointKeys"));
+	PointKeysBuffer.Bind(Initializer.ParameterMap, TEXT("PointKeysBuffer"));
+	BitonicPasses.Bind(Initializer.ParameterMap, TEXT("BitonicPasses"));
+	PassIndex.Bind(Initializer.ParameterMap, TEXT("g_iPassIndex"));
 }
 
 void FComputeShaderDeclaration::ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
 {
 	FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	FPermutationDomain(Parameters.PermutationId).ModifyCompilationEnvironment(OutEnvironment);
 	OutEnvironment.CompilerFlags.Add(CFLAG_StandardOptimization);
+	OutEnvironment.SetDefine(TEXT("BITONIC_BLOCK_SIZE"), BITONIC_BLOCK_SIZE);
+	OutEnvironment.SetDefine(TEXT("TRANSPOSE_BLOCK_SIZE"), TRANSPOSE_BLOCK_SIZE);
+	OutEnvironment.SetDefine(TEXT("SORT_WAVE_OPS"), SupportsSortWaveOps(Parameters.Platform) ? 1 : 0);
 }
 
-void FComputeShaderDeclaration::SetOutputTexture(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIRef OutputSurfaceUAV)
+template<typename TRHICmdList>
+void FComputeShaderDeclaration::SetOutputTexture(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef OutputSurfaceUAV)
 {
 	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
@@ -58,7 +67,8 @@ void FComputeShaderDeclaration::SetOutputTexture(FRHICommandList& RHICmdList, FU
 		RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputTexture.GetBaseIndex(), OutputSurfaceUAV);
 }
 
-void FComputeShaderDeclaration::SetPointPosData(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV, FUnorderedAccessViewRHIRef BufferUAV2) {
+template<typename TRHICmdList>
+void FComputeShaderDeclaration::SetPointPosData(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV, FUnorderedAccessViewRHIRef BufferUAV2) {
 
 	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
@@ -68,7 +78,8 @@ void FComputeShaderDeclaration::SetPointPosData(FRHICommandList& RHICmdList, FUn
 		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointPosDataBuffer.GetBaseIndex(), BufferUAV2);
 }
 
-void FComputeShaderDeclaration::SetPointColorData(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV, FUnorderedAccessViewRHIRef BufferUAV2) {
+template<typename TRHICmdList>
+void FComputeShaderDeclaration::SetPointColorData(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV, FUnorderedAccessViewRHIRef BufferUAV2) {
 
 	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
@@ -78,7 +89,8 @@ void FComputeShaderDeclaration::SetPointColorData(FRHICommandList& RHICmdList, F
 		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointColorDataBuffer.GetBaseIndex(), BufferUAV2);
 }
 
-void FComputeShaderDeclaration::SetPointColorTexture(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV) {
+template<typename TRHICmdList>
+void FComputeShaderDeclaration::SetPointColorTexture(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV) {
 
 	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
@@ -86,20 +98,37 @@ void FComputeShaderDeclaration::SetPointColorTexture(FRHICommandList& RHICmdList
 		RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputColorTexture.GetBaseIndex(), BufferUAV);
 }
 
-void FComputeShaderDeclaration::SetUniformBuffers(FRHICommandList& RHICmdList, FComputeShaderConstantParameters& ConstantParameters, FComputeShaderVariableParameters& VariableParameters)
-{
-	FComputeShaderConstantParametersRef ConstantParametersBuffer;
-	FComputeShaderVariableParametersRef VariableParametersBuffer;
+template<typename TRHICmdList>
+void FComputeShaderDeclaration::SetPointKeys(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV, FUnorderedAccessViewRHIRef BufferUAV2) {
+
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
-	ConstantParametersBuffer = FComputeShaderConstantParametersRef::CreateUniformBufferImmediate(ConstantParameters, UniformBuffer_SingleDraw);
-	VariableParametersBuffer = FComputeShaderVariableParametersRef::CreateUniformBufferImmediate(VariableParameters, UniformBuffer_SingleDraw);
+	if (PointKeys.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointKeys.GetBaseIndex(), BufferUAV);
+	if (PointKeysBuffer.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointKeysBuffer.GetBaseIndex(), BufferUAV2);
+}
 
+template<typename TRHICmdList>
+void FComputeShaderDeclaration::SetUniformBuffers(TRHICmdList& RHICmdList, const FComputeShaderConstantParametersRef& ConstantParametersBuffer, const FComputeShaderVariableParametersRef& VariableParametersBuffer)
+{
 	SetUniformBufferParameter(RHICmdList, GetComputeShader(), GetUniformBufferParameter<FComputeShaderConstantParameters>(), ConstantParametersBuffer);
 	SetUniformBufferParameter(RHICmdList, GetComputeShader(), GetUniformBufferParameter<FComputeShaderVariableParameters>(), VariableParametersBuffer);
 }
 
+template<typename TRHICmdList>
+void FComputeShaderDeclaration::SetPass(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PassTableSRV, uint32 Pass)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (BitonicPasses.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, BitonicPasses.GetBaseIndex(), PassTableSRV);
+	SetShaderValue(RHICmdList, ComputeShaderRHI, PassIndex, Pass);
+}
+
 /* Unbinds buffers that will be used elsewhere */
-void FComputeShaderDeclaration::UnbindBuffers(FRHICommandList& RHICmdList)
+template<typename TRHICmdList>
+void FComputeShaderDeclaration::UnbindBuffers(TRHICmdList& RHICmdList)
 {
 	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
@@ -111,6 +140,24 @@ void FComputeShaderDeclaration::UnbindBuffers(FRHICommandList& RHICmdList)
 		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, PointPosData.GetBaseIndex(), FShaderResourceViewRHIParamRef());
 	if (PointColorData.IsBound())
 		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointColorData.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (PointKeys.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointKeys.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (PointKeysBuffer.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointKeysBuffer.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+FComputeShaderBlockSortDeclaration::FComputeShaderBlockSortDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+: FComputeShaderDeclaration(Initializer)
+{
+	BlockShift.Bind(Initializer.ParameterMap, TEXT("g_iBlockShift"));
+}
+
+template<typename TRHICmdList>
+void FComputeShaderBlockSortDeclaration::SetBlockShift(TRHICmdList& RHICmdList, bool bShifted)
+{
+	SetShaderValue(RHICmdList, GetComputeShader(), BlockShift, bShifted ? 1u : 0u);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -121,39 +168,394 @@ FComputeShaderTransposeDeclaration::FComputeShaderTransposeDeclaration(const Sha
 	//This call is what lets the shader system know that the surface OutputTexture is going to be available in the shader. The second parameter is the name it will be known by in the shader
 	PointPosData.Bind(Initializer.ParameterMap, TEXT("PointPosData"));
 	PointPosDataBuffer.Bind(Initializer.ParameterMap, TEXT("PointPosDataBuffer"));
+	BitonicPasses.Bind(Initializer.ParameterMap, TEXT("BitonicPasses"));
+	PassIndex.Bind(Initializer.ParameterMap, TEXT("g_iPassIndex"));
 }
 
 void FComputeShaderTransposeDeclaration::ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
 {
 	FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	FPermutationDomain(Parameters.PermutationId).ModifyCompilationEnvironment(OutEnvironment);
+	OutEnvironment.CompilerFlags.Add(CFLAG_StandardOptimization);
+	OutEnvironment.SetDefine(TEXT("BITONIC_BLOCK_SIZE"), BITONIC_BLOCK_SIZE);
+	OutEnvironment.SetDefine(TEXT("TRANSPOSE_BLOCK_SIZE"), TRANSPOSE_BLOCK_SIZE);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderTransposeDeclaration::SetUniformBuffers(TRHICmdList& RHICmdList, const FComputeShaderConstantParametersRef& ConstantParametersBuffer, const FComputeShaderVariableParametersRef& VariableParametersBuffer)
+{
+	SetUniformBufferParameter(RHICmdList, GetComputeShader(), GetUniformBufferParameter<FComputeShaderConstantParameters>(), ConstantParametersBuffer);
+	SetUniformBufferParameter(RHICmdList, GetComputeShader(), GetUniformBufferParameter<FComputeShaderVariableParameters>(), VariableParametersBuffer);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderTransposeDeclaration::SetPass(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PassTableSRV, uint32 Pass)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (BitonicPasses.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, BitonicPasses.GetBaseIndex(), PassTableSRV);
+	SetShaderValue(RHICmdList, ComputeShaderRHI, PassIndex, Pass);
+}
+
+/* Unbinds buffers that will be used elsewhere */
+template<typename TRHICmdList>
+void FComputeShaderTransposeDeclaration::UnbindBuffers(TRHICmdList& RHICmdList)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (PointPosData.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, PointPosData.GetBaseIndex(), FShaderResourceViewRHIParamRef());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+FComputeShaderMergeDeclaration::FComputeShaderMergeDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer)
+: FGlobalShader(Initializer)
+{
+	PointPosData.Bind(Initializer.ParameterMap, TEXT("PointPosData"));
+	PointColorData.Bind(Initializer.ParameterMap, TEXT("PointColorData"));
+	PointKeys.Bind(Initializer.ParameterMap, TEXT("PointKeys"));
+	BitonicPasses.Bind(Initializer.ParameterMap, TEXT("BitonicPasses"));
+	PassIndex.Bind(Initializer.ParameterMap, TEXT("g_iPassIndex"));
+}
+
+void FComputeShaderMergeDeclaration::ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+{
+	FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	FPermutationDomain(Parameters.PermutationId).ModifyCompilationEnvironment(OutEnvironment);
+	OutEnvironment.CompilerFlags.Add(CFLAG_StandardOptimization);
+	OutEnvironment.SetDefine(TEXT("BITONIC_BLOCK_SIZE"), BITONIC_BLOCK_SIZE);
+	OutEnvironment.SetDefine(TEXT("TRANSPOSE_BLOCK_SIZE"), TRANSPOSE_BLOCK_SIZE);
+	OutEnvironment.SetDefine(TEXT("BITONIC_MERGE_MAX_STRIDES"), BITONIC_MERGE_MAX_STRIDES);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderMergeDeclaration::SetPointData(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef PointPosUAV, FUnorderedAccessViewRHIRef PointColorUAV, FUnorderedAccessViewRHIRef PointKeysUAV)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (PointPosData.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointPosData.GetBaseIndex(), PointPosUAV);
+	if (PointColorData.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointColorData.GetBaseIndex(), PointColorUAV);
+	if (PointKeys.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointKeys.GetBaseIndex(), PointKeysUAV);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderMergeDeclaration::SetUniformBuffers(TRHICmdList& RHICmdList, const FComputeShaderConstantParametersRef& ConstantParametersBuffer, const FComputeShaderVariableParametersRef& VariableParametersBuffer)
+{
+	SetUniformBufferParameter(RHICmdList, GetComputeShader(), GetUniformBufferParameter<FComputeShaderConstantParameters>(), ConstantParametersBuffer);
+	SetUniformBufferParameter(RHICmdList, GetComputeShader(), GetUniformBufferParameter<FComputeShaderVariableParameters>(), VariableParametersBuffer);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderMergeDeclaration::SetPass(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PassTableSRV, uint32 Pass)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (BitonicPasses.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, BitonicPasses.GetBaseIndex(), PassTableSRV);
+	SetShaderValue(RHICmdList, ComputeShaderRHI, PassIndex, Pass);
+}
+
+/* Unbinds buffers that will be used elsewhere */
+template<typename TRHICmdList>
+void FComputeShaderMergeDeclaration::UnbindBuffers(TRHICmdList& RHICmdList)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (PointPosData.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointPosData.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (PointColorData.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointColorData.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (PointKeys.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, PointKeys.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+FComputeShaderKeyIndexDeclaration::FComputeShaderKeyIndexDeclaration(const FGlobalShaderType::CompiledShaderInitializerType& Initializer)
+: FGlobalShader(Initializer)
+{
+	PointPosData.Bind(Initializer.ParameterMap, TEXT("PointPosData"));
+	PointColorData.Bind(Initializer.ParameterMap, TEXT("PointColorData"));
+	SortKeys.Bind(Initializer.ParameterMap, TEXT("SortKeys"));
+	SortKeysOut.Bind(Initializer.ParameterMap, TEXT("SortKeysOut"));
+	OutputTexture.Bind(Initializer.ParameterMap, TEXT("OutputTexture"));
+	OutputColorTexture.Bind(Initializer.ParameterMap, TEXT("OutputColorTexture"));
+	PointSegments.Bind(Initializer.ParameterMap, TEXT("PointSegments"));
+	CullCounters.Bind(Initializer.ParameterMap, TEXT("CullCounters"));
+	CullDispatchArgs.Bind(Initializer.ParameterMap, TEXT("CullDispatchArgs"));
+	ViewOrder.Bind(Initializer.ParameterMap, TEXT("ViewOrder"));
+	BitonicPasses.Bind(Initializer.ParameterMap, TEXT("BitonicPasses"));
+	PassIndex.Bind(Initializer.ParameterMap, TEXT("g_iPassIndex"));
+}
+
+void FComputeShaderKeyIndexDeclaration::ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+{
+	FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	FPermutationDomain(Parameters.PermutationId).ModifyCompilationEnvironment(OutEnvironment);
 	OutEnvironment.CompilerFlags.Add(CFLAG_StandardOptimization);
+	OutEnvironment.SetDefine(TEXT("BITONIC_BLOCK_SIZE"), BITONIC_BLOCK_SIZE);
+	OutEnvironment.SetDefine(TEXT("TRANSPOSE_BLOCK_SIZE"), TRANSPOSE_BLOCK_SIZE);
+	OutEnvironment.SetDefine(TEXT("SORT_WAVE_OPS"), SupportsSortWaveOps(Parameters.Platform) ? 1 : 0);
+	OutEnvironment.SetDefine(TEXT("BITONIC_MERGE_MAX_STRIDES"), BITONIC_MERGE_MAX_STRIDES);
+	OutEnvironment.SetDefine(TEXT("SORT_MAX_SEGMENTS"), MAX_SORT_SEGMENTS);
+	OutEnvironment.SetDefine(TEXT("RADIX_BLOCK_SIZE"), RADIX_BLOCK_SIZE);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderKeyIndexDeclaration::SetPointData(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PointPosSRV, FShaderResourceViewRHIRef PointColorSRV)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (PointPosData.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, PointPosData.GetBaseIndex(), PointPosSRV);
+	if (PointColorData.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, PointColorData.GetBaseIndex(), PointColorSRV);
 }
 
-void FComputeShaderTransposeDeclaration::SetUniformBuffers(FRHICommandList& RHICmdList, FComputeShaderConstantParameters& ConstantParameters, FComputeShaderVariableParameters& VariableParameters)
+template<typename TRHICmdList>
+void FComputeShaderKeyIndexDeclaration::SetSortKeys(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef SortKeysUAV, FUnorderedAccessViewRHIRef SortKeysOutUAV)
 {
-	FComputeShaderConstantParametersRef ConstantParametersBuffer;
-	FComputeShaderVariableParametersRef VariableParametersBuffer;
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (SortKeys.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, SortKeys.GetBaseIndex(), SortKeysUAV);
+	if (SortKeysOut.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, SortKeysOut.GetBaseIndex(), SortKeysOutUAV);
+}
 
-	ConstantParametersBuffer = FComputeShaderConstantParametersRef::CreateUniformBufferImmediate(ConstantParameters, UniformBuffer_SingleDraw);
-	VariableParametersBuffer = FComputeShaderVariableParametersRef::CreateUniformBufferImmediate(VariableParameters, UniformBuffer_SingleDraw);
+template<typename TRHICmdList>
+void FComputeShaderKeyIndexDeclaration::SetOutputTextures(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef PointPosTextureUAV, FUnorderedAccessViewRHIRef PointColorTextureUAV)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
+	if (OutputTexture.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputTexture.GetBaseIndex(), PointPosTextureUAV);
+	if (OutputColorTexture.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputColorTexture.GetBaseIndex(), PointColorTextureUAV);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderKeyIndexDeclaration::SetPointSegments(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PointSegmentsSRV)
+{
+	if (PointSegments.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(GetComputeShader(), PointSegments.GetBaseIndex(), PointSegmentsSRV);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderKeyIndexDeclaration::SetCullBuffers(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef CullCountersUAV, FUnorderedAccessViewRHIRef CullDispatchArgsUAV)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (CullCounters.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, CullCounters.GetBaseIndex(), CullCountersUAV);
+	if (CullDispatchArgs.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, CullDispatchArgs.GetBaseIndex(), CullDispatchArgsUAV);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderKeyIndexDeclaration::SetViewOrder(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef ViewOrderUAV)
+{
+	if (ViewOrder.IsBound())
+		RHICmdList.SetUAVParameter(GetComputeShader(), ViewOrder.GetBaseIndex(), ViewOrderUAV);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderKeyIndexDeclaration::SetUniformBuffers(TRHICmdList& RHICmdList, const FComputeShaderConstantParametersRef& ConstantParametersBuffer, const FComputeShaderVariableParametersRef& VariableParametersBuffer)
+{
 	SetUniformBufferParameter(RHICmdList, GetComputeShader(), GetUniformBufferParameter<FComputeShaderConstantParameters>(), ConstantParametersBuffer);
 	SetUniformBufferParameter(RHICmdList, GetComputeShader(), GetUniformBufferParameter<FComputeShaderVariableParameters>(), VariableParametersBuffer);
 }
 
+template<typename TRHICmdList>
+void FComputeShaderKeyIndexDeclaration::SetPass(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PassTableSRV, uint32 Pass)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (BitonicPasses.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, BitonicPasses.GetBaseIndex(), PassTableSRV);
+	SetShaderValue(RHICmdList, ComputeShaderRHI, PassIndex, Pass);
+}
+
 /* Unbinds buffers that will be used elsewhere */
-void FComputeShaderTransposeDeclaration::UnbindBuffers(FRHICommandList& RHICmdList)
+template<typename TRHICmdList>
+void FComputeShaderKeyIndexDeclaration::UnbindBuffers(TRHICmdList& RHICmdList)
 {
 	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
 
 	if (PointPosData.IsBound())
 		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, PointPosData.GetBaseIndex(), FShaderResourceViewRHIParamRef());
+	if (PointColorData.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, PointColorData.GetBaseIndex(), FShaderResourceViewRHIParamRef());
+	if (SortKeys.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, SortKeys.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (SortKeysOut.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, SortKeysOut.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (OutputTexture.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputTexture.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (OutputColorTexture.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, OutputColorTexture.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (PointSegments.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, PointSegments.GetBaseIndex(), FShaderResourceViewRHIParamRef());
+	if (CullCounters.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, CullCounters.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (CullDispatchArgs.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, CullDispatchArgs.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (ViewOrder.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, ViewOrder.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+FComputeShaderKeyBlockSortDeclaration::FComputeShaderKeyBlockSortDeclaration(const FGlobalShaderType::CompiledShaderInitializerType& Initializer)
+: FComputeShaderKeyPairDeclaration(Initializer)
+{
+	BlockShift.Bind(Initializer.ParameterMap, TEXT("g_iBlockShift"));
+}
+
+template<typename TRHICmdList>
+void FComputeShaderKeyBlockSortDeclaration::SetBlockShift(TRHICmdList& RHICmdList, bool bShifted)
+{
+	SetShaderValue(RHICmdList, GetComputeShader(), BlockShift, bShifted ? 1u : 0u);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+FComputeShaderRadixDeclaration::FComputeShaderRadixDeclaration(const FGlobalShaderType::CompiledShaderInitializerType& Initializer)
+: FGlobalShader(Initializer)
+{
+	SortKeys.Bind(Initializer.ParameterMap, TEXT("SortKeys"));
+	SortKeysOut.Bind(Initializer.ParameterMap, TEXT("SortKeysOut"));
+	RadixCounters.Bind(Initializer.ParameterMap, TEXT("RadixCounters"));
+	RadixDispatchArgs.Bind(Initializer.ParameterMap, TEXT("RadixDispatchArgs"));
+	PassIndex.Bind(Initializer.ParameterMap, TEXT("g_iPassIndex"));
+}
+
+void FComputeShaderRadixDeclaration::ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+{
+	FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	OutEnvironment.CompilerFlags.Add(CFLAG_StandardOptimization);
+	OutEnvironment.SetDefine(TEXT("RADIX_BITS"), RADIX_BITS);
+	OutEnvironment.SetDefine(TEXT("RADIX_BLOCK_SIZE"), RADIX_BLOCK_SIZE);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderRadixDeclaration::SetBuffers(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef SortKeysUAV, FUnorderedAccessViewRHIRef SortKeysOutUAV, FUnorderedAccessViewRHIRef RadixCountersUAV)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (SortKeys.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, SortKeys.GetBaseIndex(), SortKeysUAV);
+	if (SortKeysOut.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, SortKeysOut.GetBaseIndex(), SortKeysOutUAV);
+	if (RadixCounters.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, RadixCounters.GetBaseIndex(), RadixCountersUAV);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderRadixDeclaration::SetDispatchArgs(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef DispatchArgsSRV)
+{
+	if (RadixDispatchArgs.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(GetComputeShader(), RadixDispatchArgs.GetBaseIndex(), DispatchArgsSRV);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderRadixDeclaration::SetUniformBuffers(TRHICmdList& RHICmdList, const FComputeShaderConstantParametersRef& ConstantParametersBuffer, const FComputeShaderVariableParametersRef& VariableParametersBuffer)
+{
+	SetUniformBufferParameter(RHICmdList, GetComputeShader(), GetUniformBufferParameter<FComputeShaderConstantParameters>(), ConstantParametersBuffer);
+	SetUniformBufferParameter(RHICmdList, GetComputeShader(), GetUniformBufferParameter<FComputeShaderVariableParameters>(), VariableParametersBuffer);
+}
+
+template<typename TRHICmdList>
+void FComputeShaderRadixDeclaration::SetRadixPass(TRHICmdList& RHICmdList, uint32 Pass)
+{
+	SetShaderValue(RHICmdList, GetComputeShader(), PassIndex, Pass);
+}
+
+/* Unbinds buffers that will be used elsewhere */
+template<typename TRHICmdList>
+void FComputeShaderRadixDeclaration::UnbindBuffers(TRHICmdList& RHICmdList)
+{
+	FComputeShaderRHIParamRef ComputeShaderRHI = GetComputeShader();
+
+	if (SortKeys.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, SortKeys.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (SortKeysOut.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, SortKeysOut.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (RadixCounters.IsBound())
+		RHICmdList.SetUAVParameter(ComputeShaderRHI, RadixCounters.GetBaseIndex(), FUnorderedAccessViewRHIRef());
+	if (RadixDispatchArgs.IsBound())
+		RHICmdList.SetShaderResourceViewParameter(ComputeShaderRHI, RadixDispatchArgs.GetBaseIndex(), FShaderResourceViewRHIParamRef());
 }
 
 //This is what will instantiate the shader into the engine from the engine/Shaders folder
 //                      ShaderType                    ShaderFileName                Shader function name       Type
+// The setters work on the graphics command lists and on the async compute command list
+#define INSTANTIATE_COMPUTE_SHADER_SETTERS(TRHICmdList) \
+	template void FComputeShaderDeclaration::SetOutputTexture<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderDeclaration::SetPointPosData<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderDeclaration::SetPointColorData<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderDeclaration::SetPointColorTexture<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderDeclaration::SetPointKeys<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderDeclaration::SetUniformBuffers<TRHICmdList>(TRHICmdList&, const FComputeShaderConstantParametersRef&, const FComputeShaderVariableParametersRef&); \
+	template void FComputeShaderDeclaration::SetPass<TRHICmdList>(TRHICmdList&, FShaderResourceViewRHIRef, uint32); \
+	template void FComputeShaderDeclaration::UnbindBuffers<TRHICmdList>(TRHICmdList&); \
+	template void FComputeShaderBlockSortDeclaration::SetBlockShift<TRHICmdList>(TRHICmdList&, bool); \
+	template void FComputeShaderTransposeDeclaration::SetUniformBuffers<TRHICmdList>(TRHICmdList&, const FComputeShaderConstantParametersRef&, const FComputeShaderVariableParametersRef&); \
+	template void FComputeShaderTransposeDeclaration::SetPass<TRHICmdList>(TRHICmdList&, FShaderResourceViewRHIRef, uint32); \
+	template void FComputeShaderTransposeDeclaration::UnbindBuffers<TRHICmdList>(TRHICmdList&); \
+	template void FComputeShaderMergeDeclaration::SetPointData<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef, FUnorderedAccessViewRHIRef, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderMergeDeclaration::SetUniformBuffers<TRHICmdList>(TRHICmdList&, const FComputeShaderConstantParametersRef&, const FComputeShaderVariableParametersRef&); \
+	template void FComputeShaderMergeDeclaration::SetPass<TRHICmdList>(TRHICmdList&, FShaderResourceViewRHIRef, uint32); \
+	template void FComputeShaderMergeDeclaration::UnbindBuffers<TRHICmdList>(TRHICmdList&); \
+	template void FComputeShaderKeyIndexDeclaration::SetPointData<TRHICmdList>(TRHICmdList&, FShaderResourceViewRHIRef, FShaderResourceViewRHIRef); \
+	template void FComputeShaderKeyIndexDeclaration::SetSortKeys<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderKeyIndexDeclaration::SetOutputTextures<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderKeyIndexDeclaration::SetPointSegments<TRHICmdList>(TRHICmdList&, FShaderResourceViewRHIRef); \
+	template void FComputeShaderKeyIndexDeclaration::SetCullBuffers<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderKeyIndexDeclaration::SetViewOrder<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderKeyIndexDeclaration::SetUniformBuffers<TRHICmdList>(TRHICmdList&, const FComputeShaderConstantParametersRef&, const FComputeShaderVariableParametersRef&); \
+	template void FComputeShaderKeyIndexDeclaration::SetPass<TRHICmdList>(TRHICmdList&, FShaderResourceViewRHIRef, uint32); \
+	template void FComputeShaderKeyIndexDeclaration::UnbindBuffers<TRHICmdList>(TRHICmdList&); \
+	template void FComputeShaderKeyBlockSortDeclaration::SetBlockShift<TRHICmdList>(TRHICmdList&, bool); \
+	template void FComputeShaderRadixDeclaration::SetBuffers<TRHICmdList>(TRHICmdList&, FUnorderedAccessViewRHIRef, FUnorderedAccessViewRHIRef, FUnorderedAccessViewRHIRef); \
+	template void FComputeShaderRadixDeclaration::SetDispatchArgs<TRHICmdList>(TRHICmdList&, FShaderResourceViewRHIRef); \
+	template void FComputeShaderRadixDeclaration::SetUniformBuffers<TRHICmdList>(TRHICmdList&, const FComputeShaderConstantParametersRef&, const FComputeShaderVariableParametersRef&); \
+	template void FComputeShaderRadixDeclaration::SetRadixPass<TRHICmdList>(TRHICmdList&, uint32); \
+	template void FComputeShaderRadixDeclaration::UnbindBuffers<TRHICmdList>(TRHICmdList&);
+
+INSTANTIATE_COMPUTE_SHADER_SETTERS(FRHICommandList)
+INSTANTIATE_COMPUTE_SHADER_SETTERS(FRHICommandListImmediate)
+INSTANTIATE_COMPUTE_SHADER_SETTERS(FRHIAsyncComputeCommandListImmediate)
+
+#undef INSTANTIATE_COMPUTE_SHADER_SETTERS
+
 IMPLEMENT_SHADER_TYPE(, FComputeShaderDeclaration, TEXT("/ComputeShaderPlugin/BitonicSortingKernelComputeShader.usf"), TEXT("MainComputeShader"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderPointKeyGenDeclaration, TEXT("/ComputeShaderPlugin/BitonicSortingKernelComputeShader.usf"), TEXT("GeneratePointKeys"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderBlockSortDeclaration, TEXT("/ComputeShaderPlugin/BitonicSortingKernelComputeShader.usf"), TEXT("BitonicSortBlocks"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderLocalSortDeclaration, TEXT("/ComputeShaderPlugin/BitonicSortingKernelComputeShader.usf"), TEXT("BitonicSortLocal"), SF_Compute);
 IMPLEMENT_SHADER_TYPE(, FComputeShaderTransposeDeclaration, TEXT("/ComputeShaderPlugin/BitonicSortingKernelComputeShader.usf"), TEXT("TransposeMatrix"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderMergeDeclaration, TEXT("/ComputeShaderPlugin/BitonicSortingKernelComputeShader.usf"), TEXT("BitonicMergeGlobal"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderKeyGenDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("GenerateSortKeys"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderKeySortDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("BitonicSortKeys"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderKeyLocalSortDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("BitonicSortKeysLocal"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderKeyRefreshDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("RefreshSortKeys"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderKeyBlockSortDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("BitonicSortKeyBlocks"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderKeyTransposeDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("TransposeSortKeys"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderKeyMergeDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("BitonicMergeKeysGlobal"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderCullDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("CullSortKeys"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderCullScanDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("CullPrefixScan"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderCullScatterDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("CullScatter"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderStoreViewOrderDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("StoreViewOrder"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderLoadViewOrderDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("LoadViewOrder"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderGatherDeclaration, TEXT("/ComputeShaderPlugin/KeyIndexSortComputeShader.usf"), TEXT("GatherSortedPoints"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderRadixHistogramDeclaration, TEXT("/ComputeShaderPlugin/RadixSortComputeShader.usf"), TEXT("RadixHistogram"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderRadixPrefixScanDeclaration, TEXT("/ComputeShaderPlugin/RadixSortComputeShader.usf"), TEXT("RadixPrefixScan"), SF_Compute);
+IMPLEMENT_SHADER_TYPE(, FComputeShaderRadixScatterDeclaration, TEXT("/ComputeShaderPlugin/RadixSortComputeShader.usf"), TEXT("RadixScatter"), SF_Compute);
 
 //This is required for the plugin to build :)
 IMPLEMENT_MODULE(FComputeShaderModule, ComputeShader)
\ No newline at end of file
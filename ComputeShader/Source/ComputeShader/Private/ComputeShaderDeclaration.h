@@ -25,27 +25,118 @@
 #pragma once
 
 #include "GlobalShader.h"
+#include "ShaderPermutation.h"
 #include "UniformBuffer.h"
 #include "RHICommandList.h"
 #include "DynamicRHIResourceArray.h"
+#include "BitonicSortSchedule.h"
+#include "ComputeShaderReference.h"
 
 //This buffer should contain variables that never, or rarely change
 BEGIN_UNIFORM_BUFFER_STRUCT(FComputeShaderConstantParameters, )
 UNIFORM_MEMBER(float, SimulationSpeed)
+UNIFORM_MEMBER(int, NumElements)
+UNIFORM_MEMBER(int, OutputTextureHeight)
+UNIFORM_MEMBER(FVector4, PointBoundsMin)
+UNIFORM_MEMBER(FVector4, PointBoundsSize)
 END_UNIFORM_BUFFER_STRUCT(FComputeShaderConstantParameters)
 
-//This buffer is for variables that change very often (each frame for example)
+//This buffer is for variables that change very often (each frame for example). It is created once per sort, the
+//parameters of the single passes are selected by a pass index (see FBitonicPassParameters).
 BEGIN_UNIFORM_BUFFER_STRUCT(FComputeShaderVariableParameters, )
 UNIFORM_MEMBER(FVector4, CurrentCamPos)
-UNIFORM_MEMBER(int, g_iLevel)
-UNIFORM_MEMBER(int, g_iLevelMask)
-UNIFORM_MEMBER(int, g_iWidth)
-UNIFORM_MEMBER(int, g_iHeight)
+UNIFORM_MEMBER(FVector4, CurrentViewDir)
+UNIFORM_MEMBER(int, g_iRadixNumGroups)
+UNIFORM_MEMBER(int, g_iNumSegments)
+UNIFORM_MEMBER(FMatrix, CullViewProjection)
 END_UNIFORM_BUFFER_STRUCT(FComputeShaderVariableParameters)
 
 typedef TUniformBufferRef<FComputeShaderConstantParameters> FComputeShaderConstantParametersRef;
 typedef TUniformBufferRef<FComputeShaderVariableParameters> FComputeShaderVariableParametersRef;
 
+// Maximum number of point clouds sorted together, the segment is stored in the upper 8 bits of the sort keys (see GetSegmentedSortKey)
+const uint32 MAX_SORT_SEGMENTS = 255;
+
+// A point cloud within the shared point buffers of a batch (see FComputeShaderBatch), same layout as in KeyIndexSortComputeShader.usf
+struct FPointSegment
+{
+	FVector4 CamPos;
+	// Only used by the view depth keys (see ESortKeyType)
+	FVector4 ViewDir;
+	uint32 Start;
+	uint32 Count;
+	uint32 Padding[2];
+};
+
+// Storage format of the point data (see PointFormat.ush), a permutation of all kernels that read or write points
+class FCompactPointFormatDim : SHADER_PERMUTATION_BOOL("COMPACT_POINT_FORMAT");
+typedef TShaderPermutationDomain<FCompactPointFormatDim> FPointFormatPermutationDomain;
+
+/************************************************************************/
+/* What the points are sorted by (see PointSortKey.ush)                 */
+/************************************************************************/
+enum class ESortKeyType : uint8
+{
+	// Squared distance to the camera position
+	Distance,
+	// Distance along the view direction, what blending needs: planar, so the order doesn't change when the camera turns
+	// around a point. Needs a view direction (see FComputeShader::ExecuteComputeShader).
+	ViewDepth,
+	// A custom scalar per point, stored in the alpha channel of the point colors (e.g. a precomputed depth or priority)
+	Attribute
+};
+
+/************************************************************************/
+/* In which direction the keys are sorted                               */
+/************************************************************************/
+enum class ESortOrder : uint8
+{
+	// Largest key first, e.g. the farthest point for alpha blending
+	BackToFront,
+	// Smallest key first, e.g. for early depth rejection. Invalid points still end up at the end.
+	FrontToBack
+};
+
+/************************************************************************/
+/* Mapping of the point positions to the space of the camera            */
+/************************************************************************/
+enum class ESortKeySwizzle : uint8
+{
+	// pos.gbr, the Z/X/Y layout of the point cloud textures
+	YZX,
+	// The positions are already in the space of the camera
+	XYZ
+};
+
+/************************************************************************/
+/* The sort key of the points. Every combination is a permutation of    */
+/* the kernels that compute keys (FPointSortKeyPermutationDomain), the  */
+/* CPU sort computes the same keys.                                     */
+/************************************************************************/
+struct FPointSortKey
+{
+	ESortKeyType Type = ESortKeyType::Distance;
+	ESortOrder Order = ESortOrder::BackToFront;
+	ESortKeySwizzle Swizzle = ESortKeySwizzle::YZX;
+
+	bool operator==(const FPointSortKey& Other) const { return Type == Other.Type && Order == Other.Order && Swizzle == Other.Swizzle; }
+	bool operator!=(const FPointSortKey& Other) const { return !(*this == Other); }
+};
+
+// The sort key selection, permutations of the kernels that compute keys in addition to the point format. No other kernel
+// looks at the keys beyond comparing them, so the sorting networks are shared by all sort keys.
+class FSortKeyTypeDim : SHADER_PERMUTATION_INT("SORT_KEY_TYPE", 3);
+class FSortFrontToBackDim : SHADER_PERMUTATION_BOOL("SORT_FRONT_TO_BACK");
+class FSortKeySwizzleDim : SHADER_PERMUTATION_BOOL("SORT_KEY_SWIZZLE_XYZ");
+typedef TShaderPermutationDomain<FCompactPointFormatDim, FSortKeyTypeDim, FSortFrontToBackDim, FSortKeySwizzleDim> FPointSortKeyPermutationDomain;
+
+// Platforms whose shader compilers provide the wave intrinsics (WaveGetLaneCount, WaveGetLaneIndex, WaveReadLaneAt).
+// The row sorts are compiled with SORT_WAVE_OPS there (see BitonicSharedSort.ush), D3D11 (SM5) keeps the barrier loop.
+inline bool SupportsSortWaveOps(EShaderPlatform Platform)
+{
+	return Platform == SP_PS4 || Platform == SP_XBOXONE_D3D12;
+}
+
 /***************************************************************************/
 /* This class is what encapsulates the shader in the engine.               */
 /* It is the main bridge between the HLSL located in the engine directory  */
@@ -56,6 +147,7 @@ class FComputeShaderDeclaration : public FGlobalShader
 	DECLARE_SHADER_TYPE(FComputeShaderDeclaration, Global);
 
 public:
+	typedef FPointFormatPermutationDomain FPermutationDomain;
 
 	FComputeShaderDeclaration() {}
 
@@ -77,23 +169,39 @@ public:
 		Ar << PointPosDataBuffer;
 		Ar << PointColorData;
 		Ar << PointColorDataBuffer;
+		Ar << PointKeys;
+		Ar << PointKeysBuffer;
+		Ar << BitonicPasses;
+		Ar << PassIndex;
 
 		return bShaderHasOutdatedParams;
 	}
 
 	// Sets the main output texture UAV (the point position texture)
-	void SetOutputTexture(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIRef OutputTextureUAV);
+	template<typename TRHICmdList>
+	void SetOutputTexture(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef OutputTextureUAV);
 	// This function is required to bind our constant / uniform buffers to the shader.
-	void SetUniformBuffers(FRHICommandList& RHICmdList, FComputeShaderConstantParameters& ConstantParameters, FComputeShaderVariableParameters& VariableParameters);
+	template<typename TRHICmdList>
+	void SetUniformBuffers(TRHICmdList& RHICmdList, const FComputeShaderConstantParametersRef& ConstantParametersBuffer, const FComputeShaderVariableParametersRef& VariableParametersBuffer);
+	// Selects the row of the pass table for the next dispatch
+	template<typename TRHICmdList>
+	void SetPass(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PassTableSRV, uint32 Pass);
 	// This is used to clean up the buffer binds after each invocation to let them be changed and used elsewhere if needed.
-	void UnbindBuffers(FRHICommandList& RHICmdList);
+	template<typename TRHICmdList>
+	void UnbindBuffers(TRHICmdList& RHICmdList);
 
 	// Sets the unsorted point position input data
-	void SetPointPosData(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV, FUnorderedAccessViewRHIRef BufferUAV2);
+	template<typename TRHICmdList>
+	void SetPointPosData(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV, FUnorderedAccessViewRHIRef BufferUAV2);
 	// Sets the unsorted point color input data
-	void SetPointColorData(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV, FUnorderedAccessViewRHIRef BufferUAV2);
+	template<typename TRHICmdList>
+	void SetPointColorData(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV, FUnorderedAccessViewRHIRef BufferUAV2);
 	// Sets the output texture for the sorted point colors
-	void SetPointColorTexture(FRHICommandList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV);
+	template<typename TRHICmdList>
+	void SetPointColorTexture(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV);
+	// Sets the sort keys of the points (permuted together with the point data)
+	template<typename TRHICmdList>
+	void SetPointKeys(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef BufferUAV, FUnorderedAccessViewRHIRef BufferUAV2);
 
 private:
 	//This is the actual output resource that we will bind to the compute shader
@@ -103,14 +211,88 @@ private:
 	FShaderResourceParameter PointPosDataBuffer;
 	FShaderResourceParameter PointColorData;
 	FShaderResourceParameter PointColorDataBuffer;
+	FShaderResourceParameter PointKeys;
+	FShaderResourceParameter PointKeysBuffer;
+	FShaderResourceParameter BitonicPasses;
+	FShaderParameter PassIndex;
+};
+
+/***************************************************************************/
+/* Common base of the kernels that compute sort keys, on top of the base   */
+/* of their sort mode. They are specialized for every sort key in addition */
+/* to the point format (FPointSortKeyPermutationDomain).                   */
+/***************************************************************************/
+template<typename TBaseShader>
+class TComputeShaderSortKeyDeclaration : public TBaseShader
+{
+public:
+	typedef FPointSortKeyPermutationDomain FPermutationDomain;
+
+	TComputeShaderSortKeyDeclaration() {}
+	explicit TComputeShaderSortKeyDeclaration(const FGlobalShaderType::CompiledShaderInitializerType& Initializer) : TBaseShader(Initializer) {}
+
+	// The common defines of the base (for the point format of the permutation) and the sort key defines
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		const FPermutationDomain PermutationVector(Parameters.PermutationId);
+		FPointFormatPermutationDomain PointFormatVector;
+		PointFormatVector.Set<FCompactPointFormatDim>(PermutationVector.Get<FCompactPointFormatDim>());
+
+		TBaseShader::ModifyCompilationEnvironment(FGlobalShaderPermutationParameters(Parameters.Platform, PointFormatVector.ToDimensionValueId()), OutEnvironment);
+		PermutationVector.ModifyCompilationEnvironment(OutEnvironment);
+	}
+};
+
+// Computes the sort key of every point once per frame, same parameters as the main kernel
+class FComputeShaderPointKeyGenDeclaration : public TComputeShaderSortKeyDeclaration<FComputeShaderDeclaration>
+{
+	DECLARE_SHADER_TYPE(FComputeShaderPointKeyGenDeclaration, Global);
+public:
+	FComputeShaderPointKeyGenDeclaration() {}
+	explicit FComputeShaderPointKeyGenDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : TComputeShaderSortKeyDeclaration<FComputeShaderDeclaration>(Initializer) {}
 };
 
 
+// Fully sorts blocks of BITONIC_BLOCK_SIZE points starting at an offset (incremental fix-up passes), same parameters as the main kernel plus the block shift
+class FComputeShaderBlockSortDeclaration : public FComputeShaderDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderBlockSortDeclaration, Global);
+public:
+	FComputeShaderBlockSortDeclaration() {}
+	explicit FComputeShaderBlockSortDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer);
+
+	virtual bool Serialize(FArchive& Ar) override
+	{
+		bool bShaderHasOutdatedParams = FComputeShaderDeclaration::Serialize(Ar);
+
+		Ar << BlockShift;
+
+		return bShaderHasOutdatedParams;
+	}
+
+	// Selects the aligned (false) or the half-block shifted (true) blocks for the next dispatch
+	template<typename TRHICmdList>
+	void SetBlockShift(TRHICmdList& RHICmdList, bool bShifted);
+
+private:
+	FShaderParameter BlockShift;
+};
+
+// Sorts the rows for all levels up to BITONIC_BLOCK_SIZE in one dispatch, same parameters as the main kernel
+class FComputeShaderLocalSortDeclaration : public FComputeShaderDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderLocalSortDeclaration, Global);
+public:
+	FComputeShaderLocalSortDeclaration() {}
+	explicit FComputeShaderLocalSortDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderDeclaration(Initializer) {}
+};
+
 class FComputeShaderTransposeDeclaration : public FGlobalShader
 {
 	DECLARE_SHADER_TYPE(FComputeShaderTransposeDeclaration, Global);
 
 public:
+	typedef FPointFormatPermutationDomain FPermutationDomain;
 
 	FComputeShaderTransposeDeclaration() {}
 
@@ -130,14 +312,21 @@ public:
 		Ar << PointPosDataBuffer;
 		Ar << PointColorData;
 		Ar << PointColorDataBuffer;
+		Ar << BitonicPasses;
+		Ar << PassIndex;
 
 		return bShaderHasOutdatedParams;
 	}
 
 	// This function is required to bind our constant / uniform buffers to the shader.
-	void SetUniformBuffers(FRHICommandList& RHICmdList, FComputeShaderConstantParameters& ConstantParameters, FComputeShaderVariableParameters& VariableParameters);
+	template<typename TRHICmdList>
+	void SetUniformBuffers(TRHICmdList& RHICmdList, const FComputeShaderConstantParametersRef& ConstantParametersBuffer, const FComputeShaderVariableParametersRef& VariableParametersBuffer);
+	// Selects the row of the pass table for the next dispatch
+	template<typename TRHICmdList>
+	void SetPass(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PassTableSRV, uint32 Pass);
 	// This is used to clean up the buffer binds after each invocation to let them be changed and used elsewhere if needed.
-	void UnbindBuffers(FRHICommandList& RHICmdList);
+	template<typename TRHICmdList>
+	void UnbindBuffers(TRHICmdList& RHICmdList);
 
 private:
 	// This is the actual output resource that we will bind to the compute shader
@@ -145,6 +334,378 @@ private:
 	FShaderResourceParameter PointPosDataBuffer;
 	FShaderResourceParameter PointColorData;
 	FShaderResourceParameter PointColorDataBuffer;
+	FShaderResourceParameter BitonicPasses;
+	FShaderParameter PassIndex;
+};
+
+/***************************************************************************/
+/* Performs up to BITONIC_MERGE_MAX_STRIDES consecutive compare-exchange   */
+/* steps of the bitonic network: every thread loads the elements of its    */
+/* strides into registers, merges them there and writes them back to       */
+/* device memory once. Used for the strides that exceed the thread group   */
+/* size, which the transpose scheme cannot cover (> 1M elements).          */
+/***************************************************************************/
+class FComputeShaderMergeDeclaration : public FGlobalShader
+{
+	DECLARE_SHADER_TYPE(FComputeShaderMergeDeclaration, Global);
+
+public:
+	typedef FPointFormatPermutationDomain FPermutationDomain;
+
+	FComputeShaderMergeDeclaration() {}
+
+	explicit FComputeShaderMergeDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer);
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters) {
+		return GetMaxSupportedFeatureLevel(Parameters.Platform) >= ERHIFeatureLevel::SM5;
+	};
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment);
+
+	virtual bool Serialize(FArchive& Ar) override
+	{
+		bool bShaderHasOutdatedParams = FGlobalShader::Serialize(Ar);
+
+		Ar << PointPosData;
+		Ar << PointColorData;
+		Ar << PointKeys;
+		Ar << BitonicPasses;
+		Ar << PassIndex;
+
+		return bShaderHasOutdatedParams;
+	}
+
+	// Sets the point position, color and key buffers that are sorted in place
+	template<typename TRHICmdList>
+	void SetPointData(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef PointPosUAV, FUnorderedAccessViewRHIRef PointColorUAV, FUnorderedAccessViewRHIRef PointKeysUAV);
+	// This function is required to bind our constant / uniform buffers to the shader.
+	template<typename TRHICmdList>
+	void SetUniformBuffers(TRHICmdList& RHICmdList, const FComputeShaderConstantParametersRef& ConstantParametersBuffer, const FComputeShaderVariableParametersRef& VariableParametersBuffer);
+	// Selects the row of the pass table for the next dispatch
+	template<typename TRHICmdList>
+	void SetPass(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PassTableSRV, uint32 Pass);
+	// This is used to clean up the buffer binds after each invocation to let them be changed and used elsewhere if needed.
+	template<typename TRHICmdList>
+	void UnbindBuffers(TRHICmdList& RHICmdList);
+
+private:
+	FShaderResourceParameter PointPosData;
+	FShaderResourceParameter PointColorData;
+	FShaderResourceParameter PointKeys;
+	FShaderResourceParameter BitonicPasses;
+	FShaderParameter PassIndex;
+};
+
+/***************************************************************************/
+/* Common base of the key/index sorting kernels: instead of moving the     */
+/* point data through the network, only compact (distance key, point       */
+/* index) pairs are sorted and the points are gathered once at the end.    */
+/***************************************************************************/
+class FComputeShaderKeyIndexDeclaration : public FGlobalShader
+{
+public:
+	typedef FPointFormatPermutationDomain FPermutationDomain;
+
+	FComputeShaderKeyIndexDeclaration() {}
+
+	explicit FComputeShaderKeyIndexDeclaration(const FGlobalShaderType::CompiledShaderInitializerType& Initializer);
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters) {
+		return GetMaxSupportedFeatureLevel(Parameters.Platform) >= ERHIFeatureLevel::SM5;
+	};
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment);
+
+	virtual bool Serialize(FArchive& Ar) override
+	{
+		bool bShaderHasOutdatedParams = FGlobalShader::Serialize(Ar);
+
+		Ar << PointPosData;
+		Ar << PointColorData;
+		Ar << SortKeys;
+		Ar << SortKeysOut;
+		Ar << OutputTexture;
+		Ar << OutputColorTexture;
+		Ar << PointSegments;
+		Ar << CullCounters;
+		Ar << CullDispatchArgs;
+		Ar << ViewOrder;
+		Ar << BitonicPasses;
+		Ar << PassIndex;
+
+		return bShaderHasOutdatedParams;
+	}
+
+	// Sets the (unsorted) point position and color data
+	template<typename TRHICmdList>
+	void SetPointData(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PointPosSRV, FShaderResourceViewRHIRef PointColorSRV);
+	// Sets the key/index buffer the kernel works on and the buffer the transpose writes to
+	template<typename TRHICmdList>
+	void SetSortKeys(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef SortKeysUAV, FUnorderedAccessViewRHIRef SortKeysOutUAV);
+	// Sets the output textures for the sorted point positions and colors
+	template<typename TRHICmdList>
+	void SetOutputTextures(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef PointPosTextureUAV, FUnorderedAccessViewRHIRef PointColorTextureUAV);
+	// Sets the point clouds of a batch (used if g_iNumSegments > 0)
+	template<typename TRHICmdList>
+	void SetPointSegments(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PointSegmentsSRV);
+	// Sets the per-group visible counts and the indirect dispatch arguments of the culling
+	template<typename TRHICmdList>
+	void SetCullBuffers(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef CullCountersUAV, FUnorderedAccessViewRHIRef CullDispatchArgsUAV);
+	// Sets the point indices of a view direction of the view order cache
+	template<typename TRHICmdList>
+	void SetViewOrder(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef ViewOrderUAV);
+	// This function is required to bind our constant / uniform buffers to the shader.
+	template<typename TRHICmdList>
+	void SetUniformBuffers(TRHICmdList& RHICmdList, const FComputeShaderConstantParametersRef& ConstantParametersBuffer, const FComputeShaderVariableParametersRef& VariableParametersBuffer);
+	// Selects the row of the pass table for the next dispatch
+	template<typename TRHICmdList>
+	void SetPass(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef PassTableSRV, uint32 Pass);
+	// This is used to clean up the buffer binds after each invocation to let them be changed and used elsewhere if needed.
+	template<typename TRHICmdList>
+	void UnbindBuffers(TRHICmdList& RHICmdList);
+
+private:
+	FShaderResourceParameter PointPosData;
+	FShaderResourceParameter PointColorData;
+	FShaderResourceParameter SortKeys;
+	FShaderResourceParameter SortKeysOut;
+	FShaderResourceParameter OutputTexture;
+	FShaderResourceParameter OutputColorTexture;
+	FShaderResourceParameter PointSegments;
+	FShaderResourceParameter CullCounters;
+	FShaderResourceParameter CullDispatchArgs;
+	FShaderResourceParameter ViewOrder;
+	FShaderResourceParameter BitonicPasses;
+	FShaderParameter PassIndex;
+};
+
+/***************************************************************************/
+/* Common base of the kernels that only move or count key/index pairs.     */
+/* They never read the point data, so they are compiled once, independent  */
+/* of the point format.                                                    */
+/***************************************************************************/
+class FComputeShaderKeyPairDeclaration : public FComputeShaderKeyIndexDeclaration
+{
+public:
+	typedef FShaderPermutationNone FPermutationDomain;
+
+	FComputeShaderKeyPairDeclaration() {}
+	explicit FComputeShaderKeyPairDeclaration(const FGlobalShaderType::CompiledShaderInitializerType& Initializer) : FComputeShaderKeyIndexDeclaration(Initializer) {}
+};
+
+// Writes a (distance key, point index) pair for every point
+class FComputeShaderKeyGenDeclaration : public TComputeShaderSortKeyDeclaration<FComputeShaderKeyIndexDeclaration>
+{
+	DECLARE_SHADER_TYPE(FComputeShaderKeyGenDeclaration, Global);
+public:
+	FComputeShaderKeyGenDeclaration() {}
+	explicit FComputeShaderKeyGenDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : TComputeShaderSortKeyDeclaration<FComputeShaderKeyIndexDeclaration>(Initializer) {}
+};
+
+// Sorts/merges the rows of key/index pairs in groupshared memory
+class FComputeShaderKeySortDeclaration : public FComputeShaderKeyPairDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderKeySortDeclaration, Global);
+public:
+	FComputeShaderKeySortDeclaration() {}
+	explicit FComputeShaderKeySortDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderKeyPairDeclaration(Initializer) {}
+};
+
+// Sorts the rows of key/index pairs for all levels up to BITONIC_BLOCK_SIZE in one dispatch
+class FComputeShaderKeyLocalSortDeclaration : public FComputeShaderKeyPairDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderKeyLocalSortDeclaration, Global);
+public:
+	FComputeShaderKeyLocalSortDeclaration() {}
+	explicit FComputeShaderKeyLocalSortDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderKeyPairDeclaration(Initializer) {}
+};
+
+// Recomputes the keys of the pairs for the current camera without changing their order
+class FComputeShaderKeyRefreshDeclaration : public TComputeShaderSortKeyDeclaration<FComputeShaderKeyIndexDeclaration>
+{
+	DECLARE_SHADER_TYPE(FComputeShaderKeyRefreshDeclaration, Global);
+public:
+	FComputeShaderKeyRefreshDeclaration() {}
+	explicit FComputeShaderKeyRefreshDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : TComputeShaderSortKeyDeclaration<FComputeShaderKeyIndexDeclaration>(Initializer) {}
+};
+
+// Fully sorts blocks of BITONIC_BLOCK_SIZE pairs starting at an offset (incremental fix-up passes)
+class FComputeShaderKeyBlockSortDeclaration : public FComputeShaderKeyPairDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderKeyBlockSortDeclaration, Global);
+public:
+	FComputeShaderKeyBlockSortDeclaration() {}
+	explicit FComputeShaderKeyBlockSortDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer);
+
+	virtual bool Serialize(FArchive& Ar) override
+	{
+		bool bShaderHasOutdatedParams = FComputeShaderKeyPairDeclaration::Serialize(Ar);
+
+		Ar << BlockShift;
+
+		return bShaderHasOutdatedParams;
+	}
+
+	// Selects the aligned (false) or the half-block shifted (true) blocks for the next dispatch
+	template<typename TRHICmdList>
+	void SetBlockShift(TRHICmdList& RHICmdList, bool bShifted);
+
+private:
+	FShaderParameter BlockShift;
+};
+
+// Transposes the key/index matrix from SortKeys into SortKeysOut
+class FComputeShaderKeyTransposeDeclaration : public FComputeShaderKeyPairDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderKeyTransposeDeclaration, Global);
+public:
+	FComputeShaderKeyTransposeDeclaration() {}
+	explicit FComputeShaderKeyTransposeDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderKeyPairDeclaration(Initializer) {}
+};
+
+// Up to BITONIC_MERGE_MAX_STRIDES compare-exchange steps of key/index pairs, merged in registers between one load and one store
+class FComputeShaderKeyMergeDeclaration : public FComputeShaderKeyPairDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderKeyMergeDeclaration, Global);
+public:
+	FComputeShaderKeyMergeDeclaration() {}
+	explicit FComputeShaderKeyMergeDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderKeyPairDeclaration(Initializer) {}
+};
+
+// Culling instead of the key generation: writes the pairs with the visible keys to SortKeysOut and counts the visible pairs per group
+class FComputeShaderCullDeclaration : public TComputeShaderSortKeyDeclaration<FComputeShaderKeyIndexDeclaration>
+{
+	DECLARE_SHADER_TYPE(FComputeShaderCullDeclaration, Global);
+public:
+	FComputeShaderCullDeclaration() {}
+	explicit FComputeShaderCullDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : TComputeShaderSortKeyDeclaration<FComputeShaderKeyIndexDeclaration>(Initializer) {}
+};
+
+// Turns the visible counts into output offsets and writes the indirect dispatch arguments (a single thread group)
+class FComputeShaderCullScanDeclaration : public FComputeShaderKeyPairDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderCullScanDeclaration, Global);
+public:
+	FComputeShaderCullScanDeclaration() {}
+	explicit FComputeShaderCullScanDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderKeyPairDeclaration(Initializer) {}
+};
+
+// Compacts the pairs from SortKeysOut into SortKeys, visible pairs first
+class FComputeShaderCullScatterDeclaration : public FComputeShaderKeyPairDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderCullScatterDeclaration, Global);
+public:
+	FComputeShaderCullScatterDeclaration() {}
+	explicit FComputeShaderCullScatterDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderKeyPairDeclaration(Initializer) {}
+};
+
+// Stores the point indices of the sorted pairs as the order of a view direction (view order cache)
+class FComputeShaderStoreViewOrderDeclaration : public FComputeShaderKeyPairDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderStoreViewOrderDeclaration, Global);
+public:
+	FComputeShaderStoreViewOrderDeclaration() {}
+	explicit FComputeShaderStoreViewOrderDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderKeyPairDeclaration(Initializer) {}
+};
+
+// Writes the pairs of a stored view order with the keys of the current camera
+class FComputeShaderLoadViewOrderDeclaration : public TComputeShaderSortKeyDeclaration<FComputeShaderKeyIndexDeclaration>
+{
+	DECLARE_SHADER_TYPE(FComputeShaderLoadViewOrderDeclaration, Global);
+public:
+	FComputeShaderLoadViewOrderDeclaration() {}
+	explicit FComputeShaderLoadViewOrderDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : TComputeShaderSortKeyDeclaration<FComputeShaderKeyIndexDeclaration>(Initializer) {}
+};
+
+// Writes the sorted points to the output textures by looking up the sorted indices
+class FComputeShaderGatherDeclaration : public FComputeShaderKeyIndexDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderGatherDeclaration, Global);
+public:
+	FComputeShaderGatherDeclaration() {}
+	explicit FComputeShaderGatherDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderKeyIndexDeclaration(Initializer) {}
+};
+
+/***************************************************************************/
+/* Common base of the radix sort kernels (RadixSortComputeShader.usf).     */
+/* They sort the key/index pairs of the key/index mode.                    */
+/***************************************************************************/
+class FComputeShaderRadixDeclaration : public FGlobalShader
+{
+public:
+
+	FComputeShaderRadixDeclaration() {}
+
+	explicit FComputeShaderRadixDeclaration(const FGlobalShaderType::CompiledShaderInitializerType& Initializer);
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters) {
+		return GetMaxSupportedFeatureLevel(Parameters.Platform) >= ERHIFeatureLevel::SM5;
+	};
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment);
+
+	virtual bool Serialize(FArchive& Ar) override
+	{
+		bool bShaderHasOutdatedParams = FGlobalShader::Serialize(Ar);
+
+		Ar << SortKeys;
+		Ar << SortKeysOut;
+		Ar << RadixCounters;
+		Ar << RadixDispatchArgs;
+		Ar << PassIndex;
+
+		return bShaderHasOutdatedParams;
+	}
+
+	// Sets the key/index pairs to sort, the scatter target and the per-group digit counters
+	template<typename TRHICmdList>
+	void SetBuffers(TRHICmdList& RHICmdList, FUnorderedAccessViewRHIRef SortKeysUAV, FUnorderedAccessViewRHIRef SortKeysOutUAV, FUnorderedAccessViewRHIRef RadixCountersUAV);
+	// Sets the indirect dispatch arguments written by the culling (read if g_iRadixNumGroups is 0)
+	template<typename TRHICmdList>
+	void SetDispatchArgs(TRHICmdList& RHICmdList, FShaderResourceViewRHIRef DispatchArgsSRV);
+	// This function is required to bind our constant / uniform buffers to the shader.
+	template<typename TRHICmdList>
+	void SetUniformBuffers(TRHICmdList& RHICmdList, const FComputeShaderConstantParametersRef& ConstantParametersBuffer, const FComputeShaderVariableParametersRef& VariableParametersBuffer);
+	// Sets the number of the radix pass, which selects the digit
+	template<typename TRHICmdList>
+	void SetRadixPass(TRHICmdList& RHICmdList, uint32 Pass);
+	// This is used to clean up the buffer binds after each invocation to let them be changed and used elsewhere if needed.
+	template<typename TRHICmdList>
+	void UnbindBuffers(TRHICmdList& RHICmdList);
+
+private:
+	FShaderResourceParameter SortKeys;
+	FShaderResourceParameter SortKeysOut;
+	FShaderResourceParameter RadixCounters;
+	FShaderResourceParameter RadixDispatchArgs;
+	FShaderParameter PassIndex;
+};
+
+// Counts the digits of each thread group
+class FComputeShaderRadixHistogramDeclaration : public FComputeShaderRadixDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderRadixHistogramDeclaration, Global);
+public:
+	FComputeShaderRadixHistogramDeclaration() {}
+	explicit FComputeShaderRadixHistogramDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderRadixDeclaration(Initializer) {}
+};
+
+// Turns the digit counts into global output offsets
+class FComputeShaderRadixPrefixScanDeclaration : public FComputeShaderRadixDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderRadixPrefixScanDeclaration, Global);
+public:
+	FComputeShaderRadixPrefixScanDeclaration() {}
+	explicit FComputeShaderRadixPrefixScanDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderRadixDeclaration(Initializer) {}
+};
+
+// Moves the pairs to their sorted position for the current digit
+class FComputeShaderRadixScatterDeclaration : public FComputeShaderRadixDeclaration
+{
+	DECLARE_SHADER_TYPE(FComputeShaderRadixScatterDeclaration, Global);
+public:
+	FComputeShaderRadixScatterDeclaration() {}
+	explicit FComputeShaderRadixScatterDeclaration(const ShaderMetaType::CompiledShaderInitializerType& Initializer) : FComputeShaderRadixDeclaration(Initializer) {}
 };
 
 class FComputeShaderModule : public IModuleInterface
@@ -0,0 +1,206 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+#include "ComputeShaderPrivatePCH.h"
+#include "ComputeShaderReference.h"
+
+void FComputeShaderReference::RadixHistogram(const FSortKeyIndex* Keys, uint32 NumGroups, uint32 Shift, uint32* Counters)
+{
+	for (uint32 Group = 0; Group < NumGroups; ++Group)
+	{
+		uint32 Histogram[RADIX_SIZE] = { 0 };
+		for (uint32 i = 0; i < RADIX_BLOCK_SIZE; ++i)
+			Histogram[GetRadixDigit(Keys[Group * RADIX_BLOCK_SIZE + i].Key, Shift)]++;
+
+		for (uint32 Digit = 0; Digit < RADIX_SIZE; ++Digit)
+			Counters[Digit * NumGroups + Group] = Histogram[Digit];
+	}
+}
+
+void FComputeShaderReference::RadixPrefixScan(uint32* Counters, uint32 NumCounters)
+{
+	uint32 Sum = 0;
+	for (uint32 i = 0; i < NumCounters; ++i)
+	{
+		const uint32 Count = Counters[i];
+		Counters[i] = Sum;
+		Sum += Count;
+	}
+}
+
+void FComputeShaderReference::RadixScatter(const FSortKeyIndex* Keys, uint32 NumGroups, uint32 Shift, const uint32* Counters, FSortKeyIndex* KeysOut)
+{
+	for (uint32 Group = 0; Group < NumGroups; ++Group)
+	{
+		uint32 Offsets[RADIX_SIZE];
+		for (uint32 Digit = 0; Digit < RADIX_SIZE; ++Digit)
+			Offsets[Digit] = Counters[Digit * NumGroups + Group];
+
+		// Walking the group in order gives the same stable ranks as the split passes in the shader
+		for (uint32 i = 0; i < RADIX_BLOCK_SIZE; ++i)
+		{
+			const FSortKeyIndex& Element = Keys[Group * RADIX_BLOCK_SIZE + i];
+			KeysOut[Offsets[GetRadixDigit(Element.Key, Shift)]++] = Element;
+		}
+	}
+}
+
+void FComputeShaderReference::RadixSort(TArray<FSortKeyIndex>& Keys)
+{
+	check(Keys.Num() % RADIX_BLOCK_SIZE == 0);
+
+	const uint32 NumGroups = Keys.Num() / RADIX_BLOCK_SIZE;
+
+	TArray<FSortKeyIndex> KeysOut;
+	KeysOut.SetNumUninitialized(Keys.Num());
+	TArray<uint32> Counters;
+	Counters.SetNumUninitialized(RADIX_SIZE * NumGroups);
+
+	for (uint32 Pass = 0; Pass < RADIX_NUM_PASSES; ++Pass)
+	{
+		const uint32 Shift = Pass * RADIX_BITS;
+		RadixHistogram(Keys.GetData(), NumGroups, Shift, Counters.GetData());
+		RadixPrefixScan(Counters.GetData(), Counters.Num());
+		RadixScatter(Keys.GetData(), NumGroups, Shift, Counters.GetData(), KeysOut.GetData());
+		Swap(Keys, KeysOut);
+	}
+}
+
+void FComputeShaderReference::BitonicMergeRow(FSortKeyIndex* Row, uint32 RowStart, uint32 FirstStride, uint32 LevelMask, uint32 WaveSize)
+{
+	check(WaveSize == 0 || (FMath::IsPowerOfTwo(WaveSize) && WaveSize <= BITONIC_BLOCK_SIZE));
+
+	// Every thread reads before any thread writes (the barrier in between), so each step reads the previous one
+	FSortKeyIndex Result[BITONIC_BLOCK_SIZE];
+	uint32 j = FirstStride;
+
+	// Steps on the shared memory
+	for (; j > 0 && j >= WaveSize; j >>= 1)
+	{
+		for (uint32 GI = 0; GI < BITONIC_BLOCK_SIZE; ++GI)
+		{
+			const bool bFlip = (LevelMask & (RowStart + GI)) != 0;
+			Result[GI] = ((Row[GI & ~j].Key >= Row[GI | j].Key) == bFlip) ? Row[GI ^ j] : Row[GI];
+		}
+		FMemory::Memcpy(Row, Result, sizeof(Result));
+	}
+
+	// Steps within the waves: each lane only sees the register of lane ^ j of its own wave
+	for (; j > 0; j >>= 1)
+	{
+		for (uint32 WaveStart = 0; WaveStart < BITONIC_BLOCK_SIZE; WaveStart += WaveSize)
+		{
+			const FSortKeyIndex* Lanes = Row + WaveStart;
+			for (uint32 Lane = 0; Lane < WaveSize; ++Lane)
+			{
+				const uint32 GI = WaveStart + Lane;
+				const bool bFlip = (LevelMask & (RowStart + GI)) != 0;
+
+				const FSortKeyIndex& Element = Lanes[Lane];
+				const FSortKeyIndex& Partner = Lanes[Lane ^ j];
+				const uint32 Key1 = (GI & j) ? Partner.Key : Element.Key;
+				const uint32 Key2 = (GI & j) ? Element.Key : Partner.Key;
+				Result[GI] = ((Key1 >= Key2) == bFlip) ? Partner : Element;
+			}
+		}
+		FMemory::Memcpy(Row, Result, sizeof(Result));
+	}
+}
+
+void FComputeShaderReference::BitonicSortRow(FSortKeyIndex* Row, uint32 RowStart, uint32 LastLevelMask, uint32 WaveSize)
+{
+	// The levels within the row only depend on the index within the row
+	for (uint32 Level = 2; Level < BITONIC_BLOCK_SIZE; Level <<= 1)
+		BitonicMergeRow(Row, 0, Level >> 1, Level, WaveSize);
+
+	BitonicMergeRow(Row, RowStart, BITONIC_BLOCK_SIZE >> 1, LastLevelMask, WaveSize);
+}
+
+void FComputeShaderReference::BitonicMergeGlobal(FSortKeyIndex* Keys, uint32 NumKeys, uint32 Stride, uint32 NumStrides, uint32 LevelMask)
+{
+	check(NumStrides > 0 && NumStrides <= BITONIC_MERGE_MAX_STRIDES);
+
+	const uint32 NumElements = 1 << NumStrides;
+	const uint32 LowStride = Stride >> (NumStrides - 1);
+
+	for (uint32 Group = 0; Group < (NumKeys >> NumStrides); ++Group)
+	{
+		// Insert NumStrides zero bits at the lowest stride to get the first element of the thread
+		const uint32 First = ((Group & ~(LowStride - 1)) << NumStrides) | (Group & (LowStride - 1));
+		const bool bFlip = (LevelMask & First) != 0;
+
+		FSortKeyIndex Elements[1 << BITONIC_MERGE_MAX_STRIDES];
+		for (uint32 i = 0; i < NumElements; ++i)
+			Elements[i] = Keys[First + i * LowStride];
+
+		for (int32 s = NumStrides - 1; s >= 0; --s)
+		{
+			for (uint32 k = 0; k < NumElements; ++k)
+			{
+				const uint32 l = k | (1 << s);
+				if (l != k && (Elements[k].Key >= Elements[l].Key) == bFlip)
+					Swap(Elements[k], Elements[l]);
+			}
+		}
+
+		for (uint32 i = 0; i < NumElements; ++i)
+			Keys[First + i * LowStride] = Elements[i];
+	}
+}
+
+void FComputeShaderReference::BitonicSort(TArray<FSortKeyIndex>& Keys, EBitonicScheduleType ScheduleType, uint32 WaveSize)
+{
+	const uint32 NumKeys = Keys.Num();
+
+	TArray<FBitonicSortPass> Passes;
+	BuildBitonicSortSchedule(NumKeys, Passes, ScheduleType);
+
+	TArray<FSortKeyIndex> KeysOut;
+	KeysOut.SetNumUninitialized(NumKeys);
+
+	for (const FBitonicSortPass& Pass : Passes)
+	{
+		switch (Pass.Type)
+		{
+		case EBitonicPassType::SortLocal:
+			for (uint32 RowStart = 0; RowStart < NumKeys; RowStart += BITONIC_BLOCK_SIZE)
+				BitonicSortRow(&Keys[RowStart], RowStart, Pass.LevelMask, WaveSize);
+			break;
+		case EBitonicPassType::SortRows:
+			for (uint32 RowStart = 0; RowStart < NumKeys; RowStart += BITONIC_BLOCK_SIZE)
+				BitonicMergeRow(&Keys[RowStart], RowStart, Pass.Level >> 1, Pass.LevelMask, WaveSize);
+			break;
+		case EBitonicPassType::Transpose:
+			for (uint32 y = 0; y < Pass.Height; ++y)
+				for (uint32 x = 0; x < Pass.Width; ++x)
+					KeysOut[x * Pass.Height + y] = Keys[y * Pass.Width + x];
+			Swap(Keys, KeysOut);
+			break;
+		case EBitonicPassType::MergeGlobal:
+			BitonicMergeGlobal(Keys.GetData(), NumKeys, Pass.Stride, Pass.NumStrides, Pass.LevelMask);
+			break;
+		}
+	}
+}
@@ -0,0 +1,91 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BitonicSortSchedule.h"
+
+// Radix sort configuration. Passed to the shaders as defines, like the bitonic block sizes.
+const uint32 RADIX_BITS = 4;
+const uint32 RADIX_SIZE = 1 << RADIX_BITS;
+const uint32 RADIX_BLOCK_SIZE = 1024;	// Elements per thread group (one per thread)
+const uint32 RADIX_NUM_PASSES = 32 / RADIX_BITS;
+
+/************************************************************************/
+/* (distance key, point index) pair, same layout as the uint2 elements  */
+/* of the SortKeys buffers                                              */
+/************************************************************************/
+struct FSortKeyIndex
+{
+	uint32 Key;
+	uint32 Index;
+};
+
+/***************************************************************************/
+/* C++ reference implementations of the sorting kernels. They perform the  */
+/* same passes on the same data layout as the shaders, so GPU results can  */
+/* be checked bit-exactly without a GPU.                                   */
+/***************************************************************************/
+struct COMPUTESHADER_API FComputeShaderReference
+{
+	/************************************************************************/
+	/* LSD radix sort (RadixSortComputeShader.usf). Sorts in descending key */
+	/* order like the bitonic network, but stable.                          */
+	/************************************************************************/
+
+	// Digit of a key for the pass with the given shift. The key is inverted, so that an ascending radix sort yields descending keys.
+	static uint32 GetRadixDigit(uint32 Key, uint32 Shift)
+	{
+		return ((~Key) >> Shift) & (RADIX_SIZE - 1);
+	}
+
+	// RadixHistogram: counts the digits of each group. Counters are stored digit-major: Counters[Digit * NumGroups + Group]
+	static void RadixHistogram(const FSortKeyIndex* Keys, uint32 NumGroups, uint32 Shift, uint32* Counters);
+	// RadixPrefixScan: exclusive prefix sum over all counters, which yields the global output offset of each (digit, group)
+	static void RadixPrefixScan(uint32* Counters, uint32 NumCounters);
+	// RadixScatter: writes each element to the offset of its (digit, group) plus its stable rank within the group
+	static void RadixScatter(const FSortKeyIndex* Keys, uint32 NumGroups, uint32 Shift, const uint32* Counters, FSortKeyIndex* KeysOut);
+
+	// Runs all passes. The number of keys has to be a multiple of RADIX_BLOCK_SIZE.
+	static void RadixSort(TArray<FSortKeyIndex>& Keys);
+
+	/************************************************************************/
+	/* Bitonic network of the key/index kernels (KeyIndexSortComputeShader  */
+	/* .usf, BitonicSharedSort.ush). WaveSize > 0 emulates SORT_WAVE_OPS:   */
+	/* the strides below the wave size are exchanged between the lanes of   */
+	/* each wave (WaveReadLaneAt), 0 runs all steps on the shared memory.   */
+	/************************************************************************/
+
+	// MergeSharedKeys on one row of BITONIC_BLOCK_SIZE pairs: the steps FirstStride ... 1, the direction of an element is LevelMask & (RowStart + GI)
+	static void BitonicMergeRow(FSortKeyIndex* Row, uint32 RowStart, uint32 FirstStride, uint32 LevelMask, uint32 WaveSize);
+	// SortSharedKeys: all levels up to the row size, the last one in the direction LastLevelMask & (RowStart + GI)
+	static void BitonicSortRow(FSortKeyIndex* Row, uint32 RowStart, uint32 LastLevelMask, uint32 WaveSize);
+	// BitonicMergeKeysGlobal: NumStrides compare-exchange steps (Stride, Stride / 2, ...) in device memory
+	static void BitonicMergeGlobal(FSortKeyIndex* Keys, uint32 NumKeys, uint32 Stride, uint32 NumStrides, uint32 LevelMask);
+
+	// Runs all passes of the schedule (see BuildBitonicSortSchedule), descending keys. The number of keys has to be a power of two >= BITONIC_BLOCK_SIZE.
+	static void BitonicSort(TArray<FSortKeyIndex>& Keys, EBitonicScheduleType ScheduleType, uint32 WaveSize);
+};
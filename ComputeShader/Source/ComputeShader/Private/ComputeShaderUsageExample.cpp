@@ -23,63 +23,581 @@
 ******************************************************************************/
 
 #include "ComputeShaderPrivatePCH.h"
+#include "PointFormat.h"
+#include "Async/Async.h"
+#include "Containers/Ticker.h"
 
 //#define NUM_THREADS_PER_GROUP_DIMENSION 8 //This has to be the same as in the compute shader's spec [X, X, 1]
 
 const FVector4 ZeroVector = FVector4(0, 0, 0, 0);
 
+// Pads the problem size to a power of two that the bitonic network can handle
+static int32 GetPaddedProblemSize(int32 NumElements)
+{
+	check(NumElements > 0 && (uint32)NumElements <= MAX_NUM_ELEMENTS);
+	return FMath::Max<int32>(BITONIC_BLOCK_SIZE, FMath::RoundUpToPowerOfTwo(NumElements));
+}
+
+// Chooses a (nearly) square output texture that holds the whole padded problem
+static void GetOutputTextureSize(int32 PaddedNumElements, int32& OutSizeX, int32& OutSizeY)
+{
+	OutSizeY = 1 << ((FMath::CeilLogTwo(PaddedNumElements) + 1) / 2);
+	OutSizeX = PaddedNumElements / OutSizeY;
+}
+
+// Direction of a bin of the view order cache, the bins are spread evenly over the sphere (Fibonacci lattice)
+static FVector GetViewOrderBinDirection(int32 Bin, int32 NumBins)
+{
+	const float GoldenAngle = PI * (3.0f - FMath::Sqrt(5.0f));
+	const float Z = 1.0f - 2.0f * (Bin + 0.5f) / NumBins;
+	const float Radius = FMath::Sqrt(1.0f - Z * Z);
+	return FVector(FMath::Cos(GoldenAngle * Bin) * Radius, FMath::Sin(GoldenAngle * Bin) * Radius, Z);
+}
+
+FComputeShader::FComputeShader(float SimulationSpeed, int32 InNumElements, ERHIFeatureLevel::Type ShaderFeatureLevel)
+{
+	FeatureLevel = ShaderFeatureLevel;
+	ConstantParameters.SimulationSpeed = SimulationSpeed;
+	ConstantParameters.PointBoundsMin = FVector4(0.0f, 0.0f, 0.0f, 0.0f);
+	ConstantParameters.PointBoundsSize = FVector4(1.0f, 1.0f, 1.0f, 0.0f);
+	VariableParameters = FComputeShaderVariableParameters();
+
+	bIsUnloading = false;
+
+	// The sorting kernels need SM5, sort on the CPU otherwise
+	if (FeatureLevel < ERHIFeatureLevel::SM5)
+		SortStrategy = ESortStrategy::CPU;
+
+	NumElements = InNumElements;
+	PaddedNumElements = GetPaddedProblemSize(NumElements);
+
+	int32 SizeX, SizeY;
+	GetOutputTextureSize(PaddedNumElements, SizeX, SizeY);
+	CreateResources(SizeX, SizeY);
+
+	PollTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FComputeShader::TickPendingGPUWork));
+}
+
 FComputeShader::FComputeShader(float SimulationSpeed, int32 SizeX, int32 SizeY, ERHIFeatureLevel::Type ShaderFeatureLevel)
 {
 	FeatureLevel = ShaderFeatureLevel;
 	ConstantParameters.SimulationSpeed = SimulationSpeed;
+	ConstantParameters.PointBoundsMin = FVector4(0.0f, 0.0f, 0.0f, 0.0f);
+	ConstantParameters.PointBoundsSize = FVector4(1.0f, 1.0f, 1.0f, 0.0f);
 	VariableParameters = FComputeShaderVariableParameters();
 
-	bIsComputeShaderExecuting = false;
 	bIsUnloading = false;
-	bSave = false;
 
-	// Create textures
+	// The sorting kernels need SM5, sort on the CPU otherwise
+	if (FeatureLevel < ERHIFeatureLevel::SM5)
+		SortStrategy = ESortStrategy::CPU;
+
+	NumElements = SizeX * SizeY;
+	PaddedNumElements = GetPaddedProblemSize(NumElements);
+
+	CreateResources(SizeX, SizeY);
+
+	PollTickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FComputeShader::TickPendingGPUWork));
+}
+
+FComputeShader::~FComputeShader()
+{
+	bIsUnloading = true;
+	FTicker::GetCoreTicker().RemoveTicker(PollTickerHandle);
+}
+
+void FComputeShader::SetNumElements(int32 InNumElements)
+{
+	check(IsInGameThread());
+
+	if (InNumElements == NumElements)
+		return;
+
+	// Make sure the render thread is done with the old resources
+	FlushRenderingCommands();
+	ReleaseResources();
+
+	NumElements = InNumElements;
+	PaddedNumElements = GetPaddedProblemSize(NumElements);
+
+	int32 SizeX, SizeY;
+	GetOutputTextureSize(PaddedNumElements, SizeX, SizeY);
+	CreateResources(SizeX, SizeY);
+}
+
+void FComputeShader::CreateResources(int32 SizeX, int32 SizeY)
+{
+	ConstantParameters.NumElements = PaddedNumElements;
+	ConstantParameters.OutputTextureHeight = SizeY;
+	ConstantParametersBuffer.SafeRelease();
+
+	// Initialise data buffers with invalid values (keeps already uploaded points when the problem size changes)
+	const int32 OldNum = FMath::Min(PointPosData.Num(), NumElements);
+	PointPosData.SetNumZeroed(PaddedNumElements);
+	PointColorData.SetNum(PaddedNumElements);
+	for (int32 i = OldNum; i < PaddedNumElements; ++i) {
+		PointPosData[i] = ZeroVector;
+		PointColorData[i] = FVector4(0.0f, 1.0f, 0.0f, 0.0f);
+	}
+
 	FRHIResourceCreateInfo CreateInfo;
-	m_SortedPointPosTex = RHICreateTexture2D(SizeX, SizeY, PF_A32B32G32R32F, 1, 1, TexCreate_ShaderResource | TexCreate_UAV, CreateInfo);
-	m_SortedPointPosTex_UAV = RHICreateUnorderedAccessView(m_SortedPointPosTex);
 
-	m_SortedPointColorsTex = RHICreateTexture2D(SizeX, SizeY, PF_A32B32G32R32F, 1, 1, TexCreate_ShaderResource | TexCreate_UAV, CreateInfo);
-	m_SortedPointColorsTex_UAV = RHICreateUnorderedAccessView(m_SortedPointColorsTex);
+	// Nothing is in flight for the new textures
+	ReadOutputIndex.Set(0);
+	WriteOutputIndex = 1;
+	bSortResultPending = false;
+	bHasPublishedResult = false;
+
+	// The CPU strategy uploads its result into the textures and needs neither UAVs nor buffers
+	if (SortStrategy == ESortStrategy::CPU)
+	{
+		for (int32 i = 0; i < 2; ++i) {
+			m_SortedPointPosTex[i] = RHICreateTexture2D(SizeX, SizeY, PF_A32B32G32R32F, 1, 1, TexCreate_ShaderResource, CreateInfo);
+			m_SortedPointColorsTex[i] = RHICreateTexture2D(SizeX, SizeY, PF_A32B32G32R32F, 1, 1, TexCreate_ShaderResource, CreateInfo);
+			m_SortedPointPosTex_SRV[i] = RHICreateShaderResourceView(m_SortedPointPosTex[i], 0);
+			m_SortedPointColorsTex_SRV[i] = RHICreateShaderResourceView(m_SortedPointColorsTex[i], 0);
+		}
+		bUpdateDataInShader = true;
+		return;
+	}
+
+	// Create textures
+	const bool bCompact = PointFormat == EPointFormat::Compact;
+	for (int32 i = 0; i < 2; ++i) {
+		m_SortedPointPosTex[i] = RHICreateTexture2D(SizeX, SizeY, bCompact ? PF_A16B16G16R16 : PF_A32B32G32R32F, 1, 1, TexCreate_ShaderResource | TexCreate_UAV, CreateInfo);
+		m_SortedPointPosTex_UAV[i] = RHICreateUnorderedAccessView(m_SortedPointPosTex[i]);
 
-	// Initialise data buffers with invalid values
-	PointPosData.Init(ZeroVector, NUM_ELEMENTS);
-	PointColorData.Init(FVector4(0.0f, 1.0f, 0.0f, 0.0f), NUM_ELEMENTS);
+		m_SortedPointColorsTex[i] = RHICreateTexture2D(SizeX, SizeY, bCompact ? PF_R8G8B8A8 : PF_A32B32G32R32F, 1, 1, TexCreate_ShaderResource | TexCreate_UAV, CreateInfo);
+		m_SortedPointColorsTex_UAV[i] = RHICreateUnorderedAccessView(m_SortedPointColorsTex[i]);
 
-	// Create UAVs for point position buffer
-	CreateInfo.ResourceArray = &PointPosData;
-	m_PointPosDataBuffer = RHICreateStructuredBuffer(sizeof(float) * 4, sizeof(float) * 4 * NUM_ELEMENTS, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
-	m_PointPosDataBuffer_UAV = RHICreateUnorderedAccessView(m_PointPosDataBuffer, false, false);
-	m_PointPosDataBuffer_UAV2 = RHICreateUnorderedAccessView(m_PointPosDataBuffer, false, false);
+		m_SortedPointPosTex_SRV[i] = RHICreateShaderResourceView(m_SortedPointPosTex[i], 0);
+		m_SortedPointColorsTex_SRV[i] = RHICreateShaderResourceView(m_SortedPointColorsTex[i], 0);
+	}
+
+	if (!SortDoneFence) {
+		SortStartFence = RHICreateComputeFence(FName(TEXT("PointSortStart")));
+		SortDoneFence = RHICreateComputeFence(FName(TEXT("PointSortDone")));
+	}
 
-	// Create UAVs for point colors buffer
-	CreateInfo.ResourceArray = &PointColorData;
-	m_PointColorsDataBuffer = RHICreateStructuredBuffer(sizeof(float) * 4, sizeof(float) * 4 * NUM_ELEMENTS, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+	// Create UAVs for point position and color buffers. They are persistent, the data is streamed in by UpdateDataBuffers/UploadPointData.
+	const uint32 PosStride = GetPointPosStride();
+	const uint32 ColorStride = GetPointColorStride();
+	m_PointPosDataBuffer = RHICreateStructuredBuffer(PosStride, PosStride * PaddedNumElements, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+	m_PointPosDataBuffer_UAV = RHICreateUnorderedAccessView(m_PointPosDataBuffer, false, false);
+	m_PointColorsDataBuffer = RHICreateStructuredBuffer(ColorStride, ColorStride * PaddedNumElements, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
 	m_PointColorsDataBuffer_UAV = RHICreateUnorderedAccessView(m_PointColorsDataBuffer, false, false);
-	m_PointColorsDataBuffer_UAV2 = RHICreateUnorderedAccessView(m_PointColorsDataBuffer, false, false);
+
+	m_PointPosDataBuffer_SRV = RHICreateShaderResourceView(m_PointPosDataBuffer);
+	m_PointColorsDataBuffer_SRV = RHICreateShaderResourceView(m_PointColorsDataBuffer);
+
+	// Segments of a batch, rewritten with each request
+	m_PointSegmentsBuffer = RHICreateStructuredBuffer(sizeof(FPointSegment), sizeof(FPointSegment) * MAX_SORT_SEGMENTS, BUF_Dynamic | BUF_ShaderResource, CreateInfo);
+	m_PointSegmentsBuffer_SRV = RHICreateShaderResourceView(m_PointSegmentsBuffer);
+
+	if (NeedsPayloadSortBuffers())
+		CreatePayloadSortBuffers();
+	else
+		CreateSortKeyBuffers();
+
+	CreateSortPassTable();
+
+	bUpdateDataInShader = true;
 }
 
-FComputeShader::~FComputeShader()
+void FComputeShader::CreateSortKeyBuffers()
 {
-	bIsUnloading = true;
+	FRHIResourceCreateInfo CreateInfo;
+	for (int32 i = 0; i < 2; ++i) {
+		m_SortKeysBuffer[i] = RHICreateStructuredBuffer(sizeof(uint32) * 2, sizeof(uint32) * 2 * PaddedNumElements, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+		m_SortKeysBuffer_UAV[i] = RHICreateUnorderedAccessView(m_SortKeysBuffer[i], false, false);
+	}
+
+	const uint32 MaxRadixGroups = PaddedNumElements / RADIX_BLOCK_SIZE;
+	m_RadixCountersBuffer = RHICreateStructuredBuffer(sizeof(uint32), sizeof(uint32) * RADIX_SIZE * MaxRadixGroups, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+	m_RadixCountersBuffer_UAV = RHICreateUnorderedAccessView(m_RadixCountersBuffer, false, false);
+
+	// The last counter holds the number of visible points
+	m_CullCountersBuffer = RHICreateStructuredBuffer(sizeof(uint32), sizeof(uint32) * (PaddedNumElements / BITONIC_BLOCK_SIZE + 1), BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+	m_CullCountersBuffer_UAV = RHICreateUnorderedAccessView(m_CullCountersBuffer, false, false);
+	m_CullDispatchArgsBuffer = RHICreateVertexBuffer(sizeof(uint32) * 3, BUF_Static | BUF_DrawIndirect | BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+	m_CullDispatchArgsBuffer_UAV = RHICreateUnorderedAccessView(m_CullDispatchArgsBuffer, PF_R32_UINT);
+	m_CullDispatchArgsBuffer_SRV = RHICreateShaderResourceView(m_CullDispatchArgsBuffer, sizeof(uint32), PF_R32_UINT);
+}
+
+void FComputeShader::CreateSortPassTable()
+{
+	BuildBitonicSortSchedule(PaddedNumElements, SortSchedule, BitonicScheduleType);
+
+	//* The constants of all passes are uploaded once, each dispatch only selects its row */
+	TResourceArray<FBitonicPassParameters> PassTable;
+	for (const FBitonicSortPass& Pass : SortSchedule)
+		PassTable.Add(GetBitonicPassParameters(Pass));
+
+	FRHIResourceCreateInfo CreateInfo(&PassTable);
+	m_SortPassTableBuffer = RHICreateStructuredBuffer(sizeof(FBitonicPassParameters), PassTable.GetResourceDataSize(), BUF_Static | BUF_ShaderResource, CreateInfo);
+	m_SortPassTableBuffer_SRV = RHICreateShaderResourceView(m_SortPassTableBuffer);
+}
+
+void FComputeShader::CreatePayloadSortBuffers()
+{
+	FRHIResourceCreateInfo CreateInfo;
+
+	// Transpose sources of the point data
+	const uint32 PosStride = GetPointPosStride();
+	const uint32 ColorStride = GetPointColorStride();
+	m_PointPosDataBuffer2 = RHICreateStructuredBuffer(PosStride, PosStride * PaddedNumElements, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+	m_PointPosDataBuffer_UAV2 = RHICreateUnorderedAccessView(m_PointPosDataBuffer2, false, false);
+	m_PointColorsDataBuffer2 = RHICreateStructuredBuffer(ColorStride, ColorStride * PaddedNumElements, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+	m_PointColorsDataBuffer_UAV2 = RHICreateUnorderedAccessView(m_PointColorsDataBuffer2, false, false);
+
+	// Create UAVs for the point sort keys
+	m_PointKeysBuffer = RHICreateStructuredBuffer(sizeof(uint32), sizeof(uint32) * PaddedNumElements, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+	m_PointKeysBuffer_UAV = RHICreateUnorderedAccessView(m_PointKeysBuffer, false, false);
+	m_PointKeysBuffer2 = RHICreateStructuredBuffer(sizeof(uint32), sizeof(uint32) * PaddedNumElements, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+	m_PointKeysBuffer_UAV2 = RHICreateUnorderedAccessView(m_PointKeysBuffer2, false, false);
+}
+
+FPointFormatPermutationDomain FComputeShader::GetPointFormatPermutation() const
+{
+	FPointFormatPermutationDomain PermutationVector;
+	PermutationVector.Set<FCompactPointFormatDim>(PointFormat == EPointFormat::Compact);
+	return PermutationVector;
+}
+
+FPointSortKeyPermutationDomain FComputeShader::GetPointSortKeyPermutation() const
+{
+	FPointSortKeyPermutationDomain PermutationVector;
+	PermutationVector.Set<FCompactPointFormatDim>(PointFormat == EPointFormat::Compact);
+	PermutationVector.Set<FSortKeyTypeDim>((int32)SortKey.Type);
+	PermutationVector.Set<FSortFrontToBackDim>(SortKey.Order == ESortOrder::FrontToBack);
+	PermutationVector.Set<FSortKeySwizzleDim>(SortKey.Swizzle == ESortKeySwizzle::XYZ);
+	return PermutationVector;
+}
+
+uint32 FComputeShader::GetPointPosStride() const
+{
+	return PointFormat == EPointFormat::Compact ? sizeof(FPackedPointPos) : sizeof(FVector4);
+}
+
+uint32 FComputeShader::GetPointColorStride() const
+{
+	return PointFormat == EPointFormat::Compact ? sizeof(uint32) : sizeof(FVector4);
+}
+
+void FComputeShader::WritePointData(void* PointPosDest, void* PointColorDest, const FVector4* InPointPos, const FVector4* InPointColors, int32 Num) const
+{
+	if (PointFormat == EPointFormat::Float32) {
+		FMemory::Memcpy(PointPosDest, InPointPos, sizeof(FVector4) * Num);
+		FMemory::Memcpy(PointColorDest, InPointColors, sizeof(FVector4) * Num);
+		return;
+	}
+
+	//* Pack straight into the locked buffer memory */
+	const FVector BoundsMin(ConstantParameters.PointBoundsMin);
+	const FVector InvBoundsSize = FVector(1.0f) / FVector(ConstantParameters.PointBoundsSize);
+
+	FPackedPointPos* PackedPos = (FPackedPointPos*)PointPosDest;
+	uint32* PackedColors = (uint32*)PointColorDest;
+	for (int32 i = 0; i < Num; ++i) {
+		PackedPos[i] = PackPointPos(InPointPos[i], BoundsMin, InvBoundsSize);
+		PackedColors[i] = PackPointColor(InPointColors[i]);
+	}
+}
+
+void FComputeShader::SetSortMode(ESortMode Mode)
+{
+	check(IsInGameThread());
+
+	if (Mode == SortMode)
+		return;
+
+	// The segments of a batch are found by the index of the points, the payload sort moves them
+	check(Mode == ESortMode::KeyIndex || NumPointSegments == 0 || SortStrategy == ESortStrategy::Radix);
+
+	// Make sure the render thread is done with the current buffers
+	FlushRenderingCommands();
+	SortMode = Mode;
+
+	if (SortMode == ESortMode::KeyIndex && SortStrategy != ESortStrategy::CPU && !m_SortKeysBuffer[0])
+		CreateSortKeyBuffers();
+	if (NeedsPayloadSortBuffers() && !m_PointKeysBuffer)
+		CreatePayloadSortBuffers();
+
+	// Any order of the points is a valid input for both modes (also after uploads via SetPointData), only the last result is invalid
+	bHasSortResult = false;
+}
+
+void FComputeShader::SetSortStrategy(ESortStrategy Strategy)
+{
+	check(IsInGameThread());
+
+	if (Strategy == SortStrategy)
+		return;
+
+	check(NumPointSegments == 0 || (Strategy != ESortStrategy::CPU && (Strategy == ESortStrategy::Radix || SortMode == ESortMode::KeyIndex)));
+
+	// Make sure the render thread is done with the current buffers
+	FlushRenderingCommands();
+
+	// The CPU strategy uses different resources
+	if ((Strategy == ESortStrategy::CPU) != (SortStrategy == ESortStrategy::CPU))
+	{
+		check(Strategy == ESortStrategy::CPU || FeatureLevel >= ERHIFeatureLevel::SM5);
+
+		const int32 SizeX = m_SortedPointPosTex[0]->GetSizeX();
+		const int32 SizeY = m_SortedPointPosTex[0]->GetSizeY();
+		ReleaseResources();
+		CPUSort.Empty();
+		SortStrategy = Strategy;
+		// The CPU sort works on the float data arrays
+		if (SortStrategy == ESortStrategy::CPU)
+			PointFormat = EPointFormat::Float32;
+		CreateResources(SizeX, SizeY);
+		return;
+	}
+
+	SortStrategy = Strategy;
+
+	if (SortStrategy == ESortStrategy::Radix && !m_SortKeysBuffer[0])
+		CreateSortKeyBuffers();
+	if (NeedsPayloadSortBuffers() && !m_PointKeysBuffer)
+		CreatePayloadSortBuffers();
+
+	bHasSortResult = false;
+}
+
+void FComputeShader::SetBitonicSchedule(EBitonicScheduleType ScheduleType)
+{
+	check(IsInGameThread());
+
+	if (ScheduleType == BitonicScheduleType)
+		return;
+
+	// The render thread reads the schedule
+	FlushRenderingCommands();
+	BitonicScheduleType = ScheduleType;
+
+	if (SortStrategy != ESortStrategy::CPU)
+		CreateSortPassTable();
+}
+
+void FComputeShader::SetPointFormat(EPointFormat Format, const FBox& Bounds)
+{
+	check(IsInGameThread());
+	check(Format == EPointFormat::Float32 || SortStrategy != ESortStrategy::CPU);
+
+	// Make sure the render thread is done with the current buffers and constants
+	FlushRenderingCommands();
+
+	if (Bounds.IsValid) {
+		const FVector Size = Bounds.GetSize().ComponentMax(FVector(KINDA_SMALL_NUMBER));
+		ConstantParameters.PointBoundsMin = FVector4(Bounds.Min, 0.0f);
+		ConstantParameters.PointBoundsSize = FVector4(Size, 0.0f);
+		ConstantParametersBuffer.SafeRelease();
+	}
+
+	if (Format != PointFormat)
+	{
+		// Other strides and texture formats
+		const int32 SizeX = m_SortedPointPosTex[0]->GetSizeX();
+		const int32 SizeY = m_SortedPointPosTex[0]->GetSizeY();
+		ReleaseResources();
+		PointFormat = Format;
+		CreateResources(SizeX, SizeY);
+	}
+	else if (PointFormat == EPointFormat::Compact && Bounds.IsValid)
+	{
+		// The quantization depends on the bounds, the points are packed again from the data arrays (they always hold the
+		// current points, also after SetPointData). The float format doesn't depend on the bounds.
+		bUpdateDataInShader = true;
+	}
+
+	bHasSortResult = false;
+}
+
+void FComputeShader::SetSortKey(const FPointSortKey& Key)
+{
+	check(IsInGameThread());
+
+	if (Key == SortKey)
+		return;
+
+	// The render thread reads the key for the permutations, the last order and the cached orders belong to the old key
+	FlushRenderingCommands();
+	SortKey = Key;
+	InvalidateViewOrderBins();
+	bHasSortResult = false;
+}
+
+void FComputeShader::SetIncrementalSort(bool bEnable, float MaxCameraDelta, int32 NumFixupPasses, int32 FullSortInterval)
+{
+	check(IsInGameThread());
+
+	// The render thread reads the settings when it chooses the sort path
+	FlushRenderingCommands();
+	bIncrementalSort = bEnable;
+	IncrementalMaxCameraDelta = FMath::Max(0.0f, MaxCameraDelta);
+	IncrementalNumFixupPasses = FMath::Max(1, NumFixupPasses);
+	IncrementalFullSortInterval = FMath::Max(0, FullSortInterval);
+}
+
+void FComputeShader::SetViewOrderCache(bool bEnable, const FBox& Bounds, int32 NumBins, int32 NumFixupPasses)
+{
+	check(IsInGameThread());
+	check(!bEnable || (Bounds.IsValid && NumBins > 0 && SortStrategy != ESortStrategy::CPU));
+
+	// The orders are built by the key sorts
+	if (bEnable && NeedsPayloadSortBuffers())
+		SetSortMode(ESortMode::KeyIndex);
+
+	TArray<FVector> Directions;
+	for (int32 Bin = 0; bEnable && Bin < NumBins; ++Bin)
+		Directions.Add(GetViewOrderBinDirection(Bin, NumBins));
+
+	NumViewOrderBins = Directions.Num();
+	const int32 FixupPasses = FMath::Max(0, NumFixupPasses);
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_FOURPARAMETER(
+		FComputeShaderSetViewOrderCache,
+		FComputeShader*, ComputeShader, this,
+		TArray<FVector>, BinDirections, Directions,
+		FBox, CacheBounds, Bounds,
+		int32, CacheFixupPasses, FixupPasses,
+		{
+		// Drops the orders (and buffers) of the previous directions
+		ComputeShader->ViewOrderBins.Reset();
+		ComputeShader->ViewOrderBins.SetNum(BinDirections.Num());
+		for (int32 Bin = 0; Bin < BinDirections.Num(); ++Bin)
+			ComputeShader->ViewOrderBins[Bin].Direction = BinDirections[Bin];
+		ComputeShader->ViewOrderBounds = CacheBounds;
+		ComputeShader->ViewOrderNumFixupPasses = CacheFixupPasses;
+		ComputeShader->NumViewOrderBinsBuilt.Reset();
+	}
+	);
+}
+
+void FComputeShader::SetAsyncCompute(bool bEnable)
+{
+	check(IsInGameThread());
+
+	if (bEnable == bAsyncCompute)
+		return;
+
+	// The render thread reads the setting for each sort
+	FlushRenderingCommands();
+	bAsyncCompute = bEnable;
+}
+
+void FComputeShader::ReleaseResources()
+{
+	m_PointPosDataBuffer_UAV.SafeRelease();
+	m_PointPosDataBuffer_UAV2.SafeRelease();
+	m_PointColorsDataBuffer_UAV.SafeRelease();
+	m_PointColorsDataBuffer_UAV2.SafeRelease();
+	m_PointPosDataBuffer_SRV.SafeRelease();
+	m_PointColorsDataBuffer_SRV.SafeRelease();
+	m_PointKeysBuffer_UAV.SafeRelease();
+	m_PointKeysBuffer_UAV2.SafeRelease();
+	m_PointSegmentsBuffer_SRV.SafeRelease();
+	m_PointSegmentsBuffer.SafeRelease();
+
+	for (int32 i = 0; i < 2; ++i) {
+		m_SortKeysBuffer_UAV[i].SafeRelease();
+		m_SortKeysBuffer[i].SafeRelease();
+	}
+	m_RadixCountersBuffer_UAV.SafeRelease();
+	m_RadixCountersBuffer.SafeRelease();
+	m_CullCountersBuffer_UAV.SafeRelease();
+	m_CullCountersBuffer.SafeRelease();
+	m_CullDispatchArgsBuffer_UAV.SafeRelease();
+	m_CullDispatchArgsBuffer_SRV.SafeRelease();
+	m_CullDispatchArgsBuffer.SafeRelease();
+	m_SortPassTableBuffer_SRV.SafeRelease();
+	m_SortPassTableBuffer.SafeRelease();
+
+	// The directions stay, their orders are built again for the new resources
+	for (FViewOrderBin& Bin : ViewOrderBins) {
+		Bin.UAV.SafeRelease();
+		Bin.Buffer.SafeRelease();
+	}
+	InvalidateViewOrderBins();
+
+	for (int32 i = 0; i < 2; ++i) {
+		m_SortedPointPosTex_UAV[i].SafeRelease();
+		m_SortedPointColorsTex_UAV[i].SafeRelease();
+		m_SortedPointPosTex_SRV[i].SafeRelease();
+		m_SortedPointColorsTex_SRV[i].SafeRelease();
+		m_SortedPointPosTex[i].SafeRelease();
+		m_SortedPointColorsTex[i].SafeRelease();
+	}
+	m_PointPosDataBuffer.SafeRelease();
+	m_PointPosDataBuffer2.SafeRelease();
+	m_PointColorsDataBuffer.SafeRelease();
+	m_PointColorsDataBuffer2.SafeRelease();
+	m_PointKeysBuffer.SafeRelease();
+	m_PointKeysBuffer2.SafeRelease();
 }
 
 void FComputeShader::ExecuteComputeShader(FVector4 currentCamPos)
 {
-	if (bIsUnloading || bIsComputeShaderExecuting) //Skip this execution round if we are already executing
+	if (bIsUnloading)
+		return;
+
+	FSortRequest Request;
+	Request.CamPos = currentCamPos;
+	PublishSortRequest(Request);
+}
+
+void FComputeShader::ExecuteComputeShader(FVector4 currentCamPos, const FMatrix& LocalToClip)
+{
+	if (bIsUnloading)
+		return;
+
+	FSortRequest Request;
+	Request.CamPos = currentCamPos;
+	Request.bCull = true;
+	Request.CullViewProjection = LocalToClip;
+	// Clip w is the view depth of a perspective projection
+	Request.ViewDir = FVector4(FVector(LocalToClip.M[0][3], LocalToClip.M[1][3], LocalToClip.M[2][3]).GetSafeNormal(), 0.0f);
+	PublishSortRequest(Request);
+}
+
+void FComputeShader::ExecuteComputeShader(FVector4 currentCamPos, const FVector& ViewDirection)
+{
+	if (bIsUnloading)
+		return;
+
+	FSortRequest Request;
+	Request.CamPos = currentCamPos;
+	Request.ViewDir = FVector4(ViewDirection.GetSafeNormal(), 0.0f);
+	PublishSortRequest(Request);
+}
+
+void FComputeShader::ExecuteComputeShader(const FVector4* SegmentCamPos, int32 NumSegments, const FVector4* SegmentViewDir)
+{
+	check(NumSegments == NumPointSegments);
+
+	if (bIsUnloading)
 		return;
 
-	bIsComputeShaderExecuting = true;
+	FSortRequest Request;
+	Request.CamPos = FVector4(0.0f, 0.0f, 0.0f, 0.0f);
+	Request.NumSegments = NumSegments;
+	FMemory::Memcpy(Request.SegmentCamPos, SegmentCamPos, sizeof(FVector4) * NumSegments);
+	if (SegmentViewDir)
+		FMemory::Memcpy(Request.SegmentViewDir, SegmentViewDir, sizeof(FVector4) * NumSegments);
+	else
+		FMemory::Memzero(Request.SegmentViewDir, sizeof(FVector4) * NumSegments);
+	PublishSortRequest(Request);
+}
 
-	//Now set our runtime parameters!
-	VariableParameters.CurrentCamPos = currentCamPos;
+void FComputeShader::PublishSortRequest(const FSortRequest& Request)
+{
+	// Only the first request since the render thread last looked at the mailbox needs a render command, later ones just replace it
+	if (!SortRequests.Publish(Request))
+		return;
 
 	//This macro sends the function we declare inside to be run on the render thread. What we do is essentially just send this class and tell the render thread to run the internal render function as soon as it can.
-	//I am still not 100% Certain on the thread safety of this, if you are getting crashes, depending on how advanced code you have in the start of the ExecutePixelShader function, you might have to use a lock :)
 	ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
 		FComputeShaderRunner,
 		FComputeShader*, ComputeShader, this,
@@ -92,18 +610,15 @@ void FComputeShader::ExecuteComputeShader(FVector4 currentCamPos)
 void FComputeShader::ExecuteComputeShaderInternal()
 {
 	check(IsInRenderingThread());
+	SCOPE_CYCLE_COUNTER(STAT_PointSort_Execute);
 	
 	if (bIsUnloading) //If we are about to unload, so just clean up the UAV :)
 	{
-		if (NULL != m_SortedPointPosTex_UAV)
-		{
-			m_SortedPointPosTex_UAV.SafeRelease();
-			m_SortedPointPosTex_UAV = NULL;
-		}
-		if (NULL != m_SortedPointColorsTex_UAV)
-		{
-			m_SortedPointColorsTex_UAV.SafeRelease();
-			m_SortedPointColorsTex_UAV = NULL;
+		for (int32 i = 0; i < 2; ++i) {
+			m_SortedPointPosTex_UAV[i].SafeRelease();
+			m_SortedPointColorsTex_UAV[i].SafeRelease();
+			m_SortedPointPosTex_SRV[i].SafeRelease();
+			m_SortedPointColorsTex_SRV[i].SafeRelease();
 		}
 		if (NULL != m_PointPosDataBuffer_UAV) {
 			m_PointPosDataBuffer_UAV.SafeRelease();
@@ -121,153 +636,1229 @@ void FComputeShader::ExecuteComputeShaderInternal()
 			m_PointColorsDataBuffer_UAV2.SafeRelease();
 			m_PointColorsDataBuffer_UAV2 = NULL;
 		}
+		m_PointPosDataBuffer_SRV.SafeRelease();
+		m_PointColorsDataBuffer_SRV.SafeRelease();
+		m_PointKeysBuffer_UAV.SafeRelease();
+		m_PointKeysBuffer_UAV2.SafeRelease();
+		m_SortKeysBuffer_UAV[0].SafeRelease();
+		m_SortKeysBuffer_UAV[1].SafeRelease();
+		m_RadixCountersBuffer_UAV.SafeRelease();
+		m_CullCountersBuffer_UAV.SafeRelease();
+		m_CullDispatchArgsBuffer_UAV.SafeRelease();
+		m_CullDispatchArgsBuffer_SRV.SafeRelease();
+		m_SortPassTableBuffer_SRV.SafeRelease();
+		ViewOrderBins.Empty();
+		ConstantParametersBuffer.SafeRelease();
+		VariableParametersBuffer.SafeRelease();
+		GPUTimer.Release();
+		ReleasePointReadbacks();
 		return;
 	}
 	
+	/* Take the newest request, older ones have been merged into it */
+	FSortRequest Request;
+	if (!SortRequests.Consume(Request))
+		return;
+
+	const uint32 StartCycles = FPlatformTime::Cycles();
+
 	/* Get global RHI command list */
 	FRHICommandListImmediate& RHICmdList = GRHICommandList.GetImmediateCommandList();
 
-	/* Sorting routine */
-	ParallelBitonicSort(RHICmdList);
+	/* The sort of the previous execution is done (or waited for on the GPU), swap the texture sets */
+	PublishSortResult(RHICmdList);
 
-	if (bSave) { bSave = false;	SaveScreenshot(RHICmdList);	}
-	bIsComputeShaderExecuting = false;
-}
+	GPUTimer.BeginFrame(RHICmdList);
 
-void FComputeShader::ParallelBitonicSort(FRHICommandListImmediate & RHICmdList)
-{	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	/// Parallel Bitonic Sort, adapted from https://code.msdn.microsoft.com/windowsdesktop/DirectCompute-Basic-Win32-7d5a7408
-	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	VariableParameters.CurrentCamPos = Request.CamPos;
+	VariableParameters.CurrentViewDir = Request.ViewDir;
+	VariableParameters.CullViewProjection = Request.CullViewProjection;
+	UpdatePointSegmentsBuffer(Request);
 
-	//* Create Compute Shader */
-	TShaderMapRef<FComputeShaderDeclaration> ComputeShader(GetGlobalShaderMap(FeatureLevel));
-	TShaderMapRef<FComputeShaderTransposeDeclaration> ComputeShaderTranspose(GetGlobalShaderMap(FeatureLevel));
+	// Culling requests have no segments, the points of a batch have to stay within their segment
+	bCullPoints = Request.bCull && VariableParameters.g_iNumSegments == 0;
 
-	if (bUpdateDataInShader) {
-		//* Update point positions buffer with new data */
-		m_PointPosDataBuffer_UAV.SafeRelease();
-		FRHIResourceCreateInfo CreateInfo;
-		CreateInfo.ResourceArray = &PointPosData;
-		m_PointPosDataBuffer = RHICreateStructuredBuffer(sizeof(float) * 4, sizeof(float) * 4 * NUM_ELEMENTS, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
-		m_PointPosDataBuffer_UAV = RHICreateUnorderedAccessView(m_PointPosDataBuffer, false, false);
+	// Unlike the bitonic network, the radix sort doesn't need a power of two, so only the groups containing actual points are sorted.
+	// After culling, their number is only known on the GPU (0: indirect dispatches).
+	VariableParameters.g_iRadixNumGroups = bCullPoints ? 0 : FMath::DivideAndRoundUp<int32>(NumElements, RADIX_BLOCK_SIZE);
 
-		//* Update point colors buffer with new data */
-		m_PointColorsDataBuffer_UAV.SafeRelease();
-		CreateInfo.ResourceArray = &PointColorData;
-		m_PointColorsDataBuffer = RHICreateStructuredBuffer(sizeof(float) * 4, sizeof(float) * 4 * NUM_ELEMENTS, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
-		m_PointColorsDataBuffer_UAV = RHICreateUnorderedAccessView(m_PointColorsDataBuffer, false, false);
+	/* Upload new point data if requested */
+	const bool bDataChanged = UpdateDataBuffers();
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::Upload);
 
-		bUpdateDataInShader = false;
-	}
-	
-	//* Pass input data to shader */
-	ComputeShader->SetPointPosData(RHICmdList, m_PointPosDataBuffer_UAV, m_PointPosDataBuffer_UAV2);
-	ComputeShader->SetPointColorData(RHICmdList, m_PointColorsDataBuffer_UAV, m_PointColorsDataBuffer_UAV2);
+	// The cached view orders belong to the old data
+	if (bDataChanged)
+		InvalidateViewOrderBins();
 
-	/////////////////////////////////////////////////////////////////////////
-	/////////////////////////////////////////////////////////////////////////
+	/* Decide how much work is needed */
+	const ESortPath SortPath = ChooseSortPath(bDataChanged, Request);
 
-	for (UINT level = 2; level <= BITONIC_BLOCK_SIZE; level = level * 2)
+	/* Sorting routine, writes into the write set of the output textures */
+	const bool bSorted = SortPath == ESortPath::Full || SortPath == ESortPath::Incremental || SortPath == ESortPath::ViewOrder;
+	if (bSorted)
 	{
-		// Set constants
-		VariableParameters.g_iLevel = level;
-		VariableParameters.g_iLevelMask = level;
-		VariableParameters.g_iHeight = MATRIX_WIDTH;
-		VariableParameters.g_iWidth = MATRIX_HEIGHT;
-		ComputeShader->SetUniformBuffers(RHICmdList, ConstantParameters, VariableParameters);
-
-		// Sort the row data
-		ComputeShader->SetOutputTexture(RHICmdList, m_SortedPointPosTex_UAV);
-		ComputeShader->SetPointColorTexture(RHICmdList, m_SortedPointColorsTex_UAV);
-		RHICmdList.SetComputeShader(ComputeShader->GetComputeShader());
-		DispatchComputeShader(RHICmdList, *ComputeShader, 1, NUM_ELEMENTS / BITONIC_BLOCK_SIZE, 1);
-	}
-
-	// Then sort the rows and columns for the levels > than the block size
-	// Transpose. Sort the Columns. Transpose. Sort the Rows.
-	for (UINT level = (BITONIC_BLOCK_SIZE * 2); level <= NUM_ELEMENTS; level = level * 2)
+		bSortResultOnAsyncCompute = SortStrategy != ESortStrategy::CPU && bAsyncCompute && GSupportsEfficientAsyncCompute;
+
+		if (SortStrategy == ESortStrategy::CPU) {
+			SortOnCPU();
+			GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::Output);
+		}
+		else if (bSortResultOnAsyncCompute)
+			SortOnAsyncCompute(RHICmdList, SortPath);
+		else
+			DispatchSort(RHICmdList, SortPath);
+
+		NumSortsSinceFullSort = SortPath == ESortPath::Full ? 0 : NumSortsSinceFullSort + 1;
+		bSortResultPending = true;
+
+		// The graphics pipe processes its own work in order, the async compute result is published by the poll of the next frame
+		if (!bSortResultOnAsyncCompute)
+			PublishSortResult(RHICmdList);
+	}
+	else if (NeedsViewOrderBins())
 	{
-		// Transpose
-		VariableParameters.g_iLevel = level / BITONIC_BLOCK_SIZE;
-		VariableParameters.g_iLevelMask = (level & ~NUM_ELEMENTS) / BITONIC_BLOCK_SIZE;
-		VariableParameters.g_iHeight = MATRIX_HEIGHT;
-		VariableParameters.g_iWidth = MATRIX_WIDTH;
-		ComputeShaderTranspose->SetUniformBuffers(RHICmdList, ConstantParameters, VariableParameters);
-		RHICmdList.SetComputeShader(ComputeShaderTranspose->GetComputeShader());
-		DispatchComputeShader(RHICmdList, *ComputeShaderTranspose, MATRIX_HEIGHT / TRANSPOSE_BLOCK_SIZE, MATRIX_WIDTH / TRANSPOSE_BLOCK_SIZE, 1);
-
-		// Sort the transposed column data
-		ComputeShader->SetUniformBuffers(RHICmdList, ConstantParameters, VariableParameters);
-		RHICmdList.SetComputeShader(ComputeShader->GetComputeShader());
-		DispatchComputeShader(RHICmdList, *ComputeShader, 1, NUM_ELEMENTS / BITONIC_BLOCK_SIZE, 1);
-
-		// Transpose
-		VariableParameters.g_iLevel = BITONIC_BLOCK_SIZE;
-		VariableParameters.g_iLevelMask = level;
-		VariableParameters.g_iHeight = MATRIX_WIDTH;
-		VariableParameters.g_iWidth = MATRIX_HEIGHT;
-		ComputeShaderTranspose->SetUniformBuffers(RHICmdList, ConstantParameters, VariableParameters);
-		RHICmdList.SetComputeShader(ComputeShaderTranspose->GetComputeShader());
-		DispatchComputeShader(RHICmdList, *ComputeShaderTranspose, MATRIX_HEIGHT / TRANSPOSE_BLOCK_SIZE, MATRIX_WIDTH / TRANSPOSE_BLOCK_SIZE, 1);
-
-		// Sort the row data
-		ComputeShader->SetUniformBuffers(RHICmdList, ConstantParameters, VariableParameters);
-		ComputeShader->SetOutputTexture(RHICmdList, m_SortedPointPosTex_UAV);
-		ComputeShader->SetPointColorTexture(RHICmdList, m_SortedPointColorsTex_UAV);
-		RHICmdList.SetComputeShader(ComputeShader->GetComputeShader());
-		DispatchComputeShader(RHICmdList, *ComputeShader, 1, NUM_ELEMENTS / BITONIC_BLOCK_SIZE, 1);
+		// The camera rests, a good time for the missing directions of the view order cache
+		BuildViewOrderBins(RHICmdList);
 	}
-	ComputeShader->UnbindBuffers(RHICmdList);
+
+	LastSortRequest.CopyFrom(Request);
+	LastSortPath = SortPath;
+	bHasSortResult = true;
+
+	// The sorts on the async compute pipe are not measured on the GPU, the graphics pipe would only see the upload. They are counted as not measured
+	if (bSorted && bSortResultOnAsyncCompute) {
+		GPUTimer.DiscardFrame();
+		FPointSortTimings::Get().AddUnmeasuredGPUSort();
+	}
+	else
+		GPUTimer.EndFrame(RHICmdList, bSorted);
+	FPointSortTimings::Get().AddRenderThreadSample(FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles));
+
+	/* Copies of the published result for the CPU */
+	UpdatePointReadbacks(RHICmdList);
+	UpdatePendingGPUWork();
 }
 
-void FComputeShader::SaveScreenshot(FRHICommandListImmediate& RHICmdList)
+bool FComputeShader::TickPendingGPUWork(float DeltaTime)
 {
-	TArray<FColor> Bitmap;
+	if (bIsUnloading || !bHasPendingGPUWork)
+		return true;
 
-	//To access our resource we do a custom read using lockrect
-	uint32 LolStride = 0;
-	char* TextureDataPtr = (char*)RHICmdList.LockTexture2D(m_SortedPointPosTex, 0, EResourceLockMode::RLM_ReadOnly, LolStride, false);
-
-	for (uint32 Row = 0; Row < m_SortedPointPosTex->GetSizeY(); ++Row)
-	{
-		uint32* PixelPtr = (uint32*)TextureDataPtr;
-		
-		//Since we are using our custom UINT format, we need to unpack it here to access the actual colors
-		for (uint32 Col = 0; Col < m_SortedPointPosTex->GetSizeX(); ++Col)
+	ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+		FComputeShaderPollPendingGPUWork,
+		FComputeShader*, ComputeShader, this,
 		{
-			uint32 EncodedPixel = *PixelPtr;
-			uint8 r = (EncodedPixel & 0x000000FF);
-			uint8 g = (EncodedPixel & 0x0000FF00) >> 8;
-			uint8 b = (EncodedPixel & 0x00FF0000) >> 16;
-			uint8 a = (EncodedPixel & 0xFF000000) >> 24;
-			Bitmap.Add(FColor(r, g, b, a));
-
-			PixelPtr++;
-		}
-
-		// move to next row:
-		TextureDataPtr += LolStride;
+		ComputeShader->PollPendingGPUWork();
 	}
+	);
+	return true;
+}
 
-	RHICmdList.UnlockTexture2D(m_SortedPointPosTex, 0, false);
+void FComputeShader::PollPendingGPUWork()
+{
+	check(IsInRenderingThread());
 
-	// if the format and texture type is supported
-	if (Bitmap.Num())
-	{
-		// Create screenshot folder if not already present.
-		IFileManager::Get().MakeDirectory(*FPaths::ScreenShotDir(), true);
+	if (bIsUnloading)
+		return;
 
-		const FString ScreenFileName(FPaths::ScreenShotDir() / TEXT("VisualizeTexture"));
+	// The graphics pipe waits for the fence of an async sort, so the result is safe to swap in one frame after the dispatch
+	FRHICommandListImmediate& RHICmdList = GRHICommandList.GetImmediateCommandList();
+	PublishSortResult(RHICmdList);
+	UpdatePointReadbacks(RHICmdList);
+	UpdatePendingGPUWork();
+}
 
-		uint32 ExtendXWithMSAA = Bitmap.Num() / m_SortedPointPosTex->GetSizeY();
+void FComputeShader::UpdatePendingGPUWork()
+{
+	// Waiting readback requests need a result first, the next execution publishes one
+	bool bPending = bSortResultPending || (PendingPointReadbacks.Num() > 0 && bHasPublishedResult);
+	for (const FPointReadbackSlot& Slot : PointReadbacks)
+		bPending |= Slot.bInFlight;
+	bHasPendingGPUWork = bPending;
+}
 
-		// Save the contents of the array to a bitmap file. (24bit only so alpha channel is dropped)
-		FFileHelper::CreateBitmap(*ScreenFileName, ExtendXWithMSAA, m_SortedPointPosTex->GetSizeY(), Bitmap.GetData());
+void FComputeShader::PublishSortResult(FRHICommandListImmediate& RHICmdList)
+{
+	if (!bSortResultPending)
+		return;
 
-		UE_LOG(LogConsoleResponse, Display, TEXT("Content was saved to \"%s\""), *FPaths::ScreenShotDir());
-	}
-	else
-	{
-		UE_LOG(LogConsoleResponse, Error, TEXT("Failed to save BMP, format or texture type is not supported"));
-	}
+	// Everything the graphics pipe does from now on (e.g. the materials reading the textures) waits for the sort
+	if (bSortResultOnAsyncCompute)
+		RHICmdList.WaitComputeFence(SortDoneFence);
+
+	ReadOutputIndex.Set(WriteOutputIndex);
+	WriteOutputIndex = 1 - WriteOutputIndex;
+	bSortResultPending = false;
+	bHasPublishedResult = true;
+}
+
+void FComputeShader::SortOnAsyncCompute(FRHICommandListImmediate& RHICmdList, ESortPath SortPath)
+{
+	//* Hand the write set (read by the graphics pipe until the last swap) and every buffer the sort writes over to the compute pipe */
+	TArray<FUnorderedAccessViewRHIParamRef> SortUAVs;
+	SortUAVs.Add(m_SortedPointPosTex_UAV[WriteOutputIndex]);
+	SortUAVs.Add(m_SortedPointColorsTex_UAV[WriteOutputIndex]);
+	GetSortWorkUAVs(SortUAVs);
+	RHICmdList.TransitionResources(EResourceTransitionAccess::ERWBarrier, EResourceTransitionPipeline::EGfxToCompute, SortUAVs.GetData(), SortUAVs.Num(), SortStartFence);
+
+	FRHIAsyncComputeCommandListImmediate& RHICmdListCompute = FRHICommandListExecutor::GetImmediateAsyncComputeCommandList();
+	RHICmdListCompute.WaitComputeFence(SortStartFence);
+
+	DispatchSort(RHICmdListCompute, SortPath);
+
+	//* Hand everything back to the graphics pipe, which waits for the fence in PublishSortResult (the last transition writes it) */
+	TArray<FUnorderedAccessViewRHIParamRef> WorkUAVs;
+	GetSortWorkUAVs(WorkUAVs);
+	RHICmdListCompute.TransitionResources(EResourceTransitionAccess::ERWBarrier, EResourceTransitionPipeline::EComputeToGfx, WorkUAVs.GetData(), WorkUAVs.Num());
+	FUnorderedAccessViewRHIParamRef OutputUAVs[] = { m_SortedPointPosTex_UAV[WriteOutputIndex], m_SortedPointColorsTex_UAV[WriteOutputIndex] };
+	RHICmdListCompute.TransitionResources(EResourceTransitionAccess::EReadable, EResourceTransitionPipeline::EComputeToGfx, OutputUAVs, ARRAY_COUNT(OutputUAVs), SortDoneFence);
+	FRHIAsyncComputeCommandListImmediate::ImmediateDispatch(RHICmdListCompute);
+}
+
+void FComputeShader::GetSortWorkUAVs(TArray<FUnorderedAccessViewRHIParamRef>& OutUAVs) const
+{
+	// Depending on the sort mode and strategy only some of the buffers exist
+	const FUnorderedAccessViewRHIParamRef WorkUAVs[] = {
+		m_PointPosDataBuffer_UAV, m_PointColorsDataBuffer_UAV, m_PointPosDataBuffer_UAV2, m_PointColorsDataBuffer_UAV2,
+		m_PointKeysBuffer_UAV, m_PointKeysBuffer_UAV2, m_SortKeysBuffer_UAV[0], m_SortKeysBuffer_UAV[1],
+		m_RadixCountersBuffer_UAV, m_CullCountersBuffer_UAV, m_CullDispatchArgsBuffer_UAV
+	};
+	for (FUnorderedAccessViewRHIParamRef UAV : WorkUAVs)
+	{
+		if (UAV)
+			OutUAVs.Add(UAV);
+	}
+
+	for (const FViewOrderBin& Bin : ViewOrderBins)
+	{
+		if (Bin.UAV)
+			OutUAVs.Add(Bin.UAV);
+	}
+}
+
+template<typename TRHICmdList>
+void FComputeShader::DispatchSort(TRHICmdList& RHICmdList, ESortPath SortPath)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PointSort_DispatchSort);
+	const bool bSortKeys = SortStrategy == ESortStrategy::Radix || SortMode == ESortMode::KeyIndex;
+
+	//* All dispatches of the sort share the uniform buffers, the passes select their constants from the pass table */
+	if (!ConstantParametersBuffer)
+		ConstantParametersBuffer = FComputeShaderConstantParametersRef::CreateUniformBufferImmediate(ConstantParameters, UniformBuffer_MultiFrame);
+	VariableParametersBuffer = FComputeShaderVariableParametersRef::CreateUniformBufferImmediate(VariableParameters, UniformBuffer_SingleFrame);
+
+	if (SortPath == ESortPath::ViewOrder)
+		ViewOrderSortKeys(RHICmdList);
+	else if (SortPath == ESortPath::Incremental) {
+		if (bSortKeys)
+			IncrementalSortKeys(RHICmdList);
+		else
+			IncrementalSort(RHICmdList);
+	}
+	// The bitonic network would sort the whole padded range after culling, the radix sort only the groups of the visible points
+	else if (SortStrategy == ESortStrategy::Radix || (bCullPoints && bSortKeys))
+		ParallelRadixSortKeys(RHICmdList);
+	else if (SortMode == ESortMode::KeyIndex)
+		ParallelBitonicSortKeys(RHICmdList);
+	else
+		ParallelBitonicSort(RHICmdList);
+
+	//* The key sorts leave their order in the key buffers, the points are gathered once */
+	if (bSortKeys) {
+		GatherSortedPoints(RHICmdList, SortKeysResultIndex);
+		bSortKeysHoldLastOrder = true;
+	}
+
+	//* Missing directions of the view order cache, behind the sort of this execution on the same pipe */
+	if (NeedsViewOrderBins())
+		BuildViewOrderBins(RHICmdList);
+}
+
+void FComputeShader::SetPointSegments(const TArray<FPointSegment>& Segments)
+{
+	check(IsInGameThread());
+	check(Segments.Num() <= (int32)MAX_SORT_SEGMENTS);
+	check(Segments.Num() == 0 || SortStrategy != ESortStrategy::CPU);
+
+	// Points outside of the segments would be sorted behind all segments, so the segments have to be packed
+	uint32 NextStart = 0;
+	for (const FPointSegment& Segment : Segments) {
+		check(Segment.Start == NextStart);
+		NextStart += Segment.Count;
+	}
+	check(NextStart <= (uint32)NumElements);
+
+	// The segments are found by the index of the points, so the points must stay in place
+	if (Segments.Num() > 0 && NeedsPayloadSortBuffers())
+		SetSortMode(ESortMode::KeyIndex);
+
+	NumPointSegments = Segments.Num();
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
+		FComputeShaderSetPointSegments,
+		FComputeShader*, ComputeShader, this,
+		TArray<FPointSegment>, NewSegments, Segments,
+		{
+		ComputeShader->PointSegments = NewSegments;
+		ComputeShader->bHasSortResult = false;
+	}
+	);
+}
+
+void FComputeShader::UpdatePointSegmentsBuffer(const FSortRequest& Request)
+{
+	VariableParameters.g_iNumSegments = FMath::Min(Request.NumSegments, PointSegments.Num());
+	if (VariableParameters.g_iNumSegments == 0 || SortStrategy == ESortStrategy::CPU)
+		return;
+
+	//* The layout with the cameras of this request */
+	FPointSegment* SegmentData = (FPointSegment*)RHILockStructuredBuffer(m_PointSegmentsBuffer, 0, sizeof(FPointSegment) * VariableParameters.g_iNumSegments, RLM_WriteOnly);
+	for (int32 i = 0; i < VariableParameters.g_iNumSegments; ++i) {
+		SegmentData[i] = PointSegments[i];
+		SegmentData[i].CamPos = Request.SegmentCamPos[i];
+		SegmentData[i].ViewDir = Request.SegmentViewDir[i];
+	}
+	RHIUnlockStructuredBuffer(m_PointSegmentsBuffer);
+}
+
+ESortPath FComputeShader::ChooseSortPath(bool bDataChanged, const FSortRequest& Request) const
+{
+	// New data (also set by size and mode changes) invalidates the last order
+	if (!bHasSortResult || bDataChanged)
+		return ESortPath::Full;
+
+	float CameraDelta = Request.GetMaxCameraDelta(LastSortRequest, SortKey.Type == ESortKeyType::ViewDepth);
+	// Attribute keys don't depend on the camera, only another layout of the request or frustum (MAX_flt) changes the order
+	if (SortKey.Type == ESortKeyType::Attribute && CameraDelta != MAX_flt)
+		CameraDelta = 0.0f;
+	if (CameraDelta == 0.0f)
+		return ESortPath::Skipped;
+
+	if (CanUseViewOrderCache(Request))
+		return ESortPath::ViewOrder;
+
+	// The CPU radix sort is O(n) anyway and has no cheaper fix-up path. The fix-up passes can't change the set of visible points.
+	if (!bIncrementalSort || CameraDelta > IncrementalMaxCameraDelta || SortStrategy == ESortStrategy::CPU || Request.bCull)
+		return ESortPath::Full;
+
+	// The fix-up passes only move points locally, so errors of far moving points are cleaned up regularly
+	if (IncrementalFullSortInterval > 0 && NumSortsSinceFullSort >= IncrementalFullSortInterval)
+		return ESortPath::Full;
+
+	// Building the view order cache overwrites the last order of the key sorts
+	const bool bSortKeys = SortStrategy == ESortStrategy::Radix || SortMode == ESortMode::KeyIndex;
+	if (bSortKeys && !bSortKeysHoldLastOrder)
+		return ESortPath::Full;
+
+	return ESortPath::Incremental;
+}
+
+bool FComputeShader::CanUseViewOrderCache(const FSortRequest& Request) const
+{
+	if (ViewOrderBins.Num() == 0 || NumViewOrderBinsBuilt.GetValue() < ViewOrderBins.Num())
+		return false;
+
+	// The orders are loaded into the key buffers, the visible set of culling and the segments of a batch are not part of them
+	if (SortStrategy == ESortStrategy::CPU || NeedsPayloadSortBuffers() || Request.bCull || VariableParameters.g_iNumSegments > 0)
+		return false;
+
+	// Inside of the point cloud, the order depends on the position of the camera rather than on its direction
+	return !ViewOrderBounds.IsInside(FVector(Request.CamPos));
+}
+
+bool FComputeShader::NeedsViewOrderBins() const
+{
+	if (NumViewOrderBinsBuilt.GetValue() >= ViewOrderBins.Num())
+		return false;
+
+	return SortStrategy != ESortStrategy::CPU && !NeedsPayloadSortBuffers() && VariableParameters.g_iNumSegments == 0;
+}
+
+void FComputeShader::InvalidateViewOrderBins()
+{
+	for (FViewOrderBin& Bin : ViewOrderBins)
+		Bin.bValid = false;
+	NumViewOrderBinsBuilt.Reset();
+}
+
+bool FComputeShader::UpdateDataBuffers()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PointSort_Upload);
+	TArray<FPointRange> Ranges;
+	Swap(Ranges, DirtyRanges);
+
+	// The payload mode sorts the data buffers in place, so the indices don't match the buffer positions anymore.
+	// The CPU strategy reads the data arrays directly and only needs to know that something changed.
+	if (Ranges.Num() > 0 && (NeedsPayloadSortBuffers() || SortStrategy == ESortStrategy::CPU))
+		bUpdateDataInShader = true;
+
+	if (!bUpdateDataInShader)
+		return UploadDirtyRanges(Ranges);
+
+	bUpdateDataInShader = false;
+
+	// The CPU strategy reads the data arrays directly
+	if (SortStrategy == ESortStrategy::CPU)
+		return true;
+
+	//* Stream the point data into the existing buffers (the whole padded range, so the padding is valid as well) */
+	void* PointPosBufferData = RHILockStructuredBuffer(m_PointPosDataBuffer, 0, GetPointPosStride() * PaddedNumElements, RLM_WriteOnly);
+	void* PointColorBufferData = RHILockStructuredBuffer(m_PointColorsDataBuffer, 0, GetPointColorStride() * PaddedNumElements, RLM_WriteOnly);
+	WritePointData(PointPosBufferData, PointColorBufferData, PointPosData.GetData(), PointColorData.GetData(), PaddedNumElements);
+	RHIUnlockStructuredBuffer(m_PointPosDataBuffer);
+	RHIUnlockStructuredBuffer(m_PointColorsDataBuffer);
+
+	return true;
+}
+
+void FComputeShader::UpdatePointRange(int32 StartIndex, int32 Count, const FVector4* InPointPos, const FVector4* InPointColors)
+{
+	check(IsInGameThread());
+	check(StartIndex >= 0 && Count >= 0 && StartIndex + Count <= NumElements);
+	check(InPointPos && InPointColors);
+
+	if (Count == 0)
+		return;
+
+	// The render thread owns the data arrays, the points travel with the command
+	const FPointRange Range = { StartIndex, Count };
+	const TArray<FVector4> RangePointPos(InPointPos, Count);
+	const TArray<FVector4> RangePointColors(InPointColors, Count);
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_FOURPARAMETER(
+		FComputeShaderUpdatePointRange,
+		FComputeShader*, ComputeShader, this,
+		FPointRange, PointRange, Range,
+		TArray<FVector4>, PointPos, RangePointPos,
+		TArray<FVector4>, PointColors, RangePointColors,
+		{
+		ComputeShader->ApplyPointRange(PointRange, PointPos, PointColors);
+	}
+	);
+}
+
+void FComputeShader::ApplyPointRange(const FPointRange& Range, const TArray<FVector4>& InPointPos, const TArray<FVector4>& InPointColors)
+{
+	check(IsInRenderingThread());
+
+	// The data arrays always hold the current points, the next execution uploads the range from there
+	FMemory::Memcpy(&PointPosData[Range.Start], InPointPos.GetData(), sizeof(FVector4) * Range.Count);
+	FMemory::Memcpy(&PointColorData[Range.Start], InPointColors.GetData(), sizeof(FVector4) * Range.Count);
+	DirtyRanges.Add(Range);
+}
+
+void FComputeShader::SetPointPosDataReference(TArray<FLinearColor>* data)
+{
+	check(IsInGameThread());
+
+	if (data->Num() > NumElements)
+		SetNumElements(data->Num());
+
+	// The render thread owns the data arrays, the converted points travel with the command
+	TArray<FVector4> NewPointPos;
+	NewPointPos.SetNumUninitialized(data->Num());
+	for (int32 i = 0; i < data->Num(); ++i)
+		NewPointPos[i] = FVector4((*data)[i]);
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
+		FComputeShaderSetPointPosData,
+		FComputeShader*, ComputeShader, this,
+		TArray<FVector4>, PointPos, NewPointPos,
+		{
+		FMemory::Memcpy(ComputeShader->PointPosData.GetData(), PointPos.GetData(), sizeof(FVector4) * PointPos.Num());
+	}
+	);
+}
+
+void FComputeShader::SetPointColorDataReference(TArray<uint8>* data)
+{
+	check(IsInGameThread());
+
+	const int32 NumPoints = data->Num() / 4;
+	if (NumPoints > NumElements)
+		SetNumElements(NumPoints);
+
+	TArray<FVector4> NewPointColors;
+	NewPointColors.SetNumUninitialized(NumPoints);
+	for (int32 i = 0; i < NumPoints; ++i) {
+		FColor color = FColor(((float)(*data)[i * 4 + 2]), ((float)(*data)[i * 4 + 1]), ((float)(*data)[i * 4]), ((float)(*data)[i * 4 + 3]));
+		NewPointColors[i] = FVector4(FLinearColor(color));
+	}
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
+		FComputeShaderSetPointColorData,
+		FComputeShader*, ComputeShader, this,
+		TArray<FVector4>, PointColors, NewPointColors,
+		{
+		FMemory::Memcpy(ComputeShader->PointColorData.GetData(), PointColors.GetData(), sizeof(FVector4) * PointColors.Num());
+	}
+	);
+}
+
+void FComputeShader::UpdateDataInShader()
+{
+	// The flag is read and cleared by the render thread
+	ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+		FComputeShaderUpdateDataInShader,
+		FComputeShader*, ComputeShader, this,
+		{
+		ComputeShader->bUpdateDataInShader = true;
+	}
+	);
+}
+
+bool FComputeShader::UploadDirtyRanges(TArray<FPointRange>& Ranges)
+{
+	if (Ranges.Num() == 0)
+		return false;
+
+	//* Merge overlapping and adjacent ranges, so every region is locked only once */
+	Ranges.Sort([](const FPointRange& A, const FPointRange& B) { return A.Start < B.Start; });
+
+	int32 NumMerged = 0;
+	for (int32 i = 1; i < Ranges.Num(); ++i)
+	{
+		FPointRange& Merged = Ranges[NumMerged];
+		if (Ranges[i].Start <= Merged.Start + Merged.Count)
+			Merged.Count = FMath::Max(Merged.Start + Merged.Count, Ranges[i].Start + Ranges[i].Count) - Merged.Start;
+		else
+			Ranges[++NumMerged] = Ranges[i];
+	}
+	Ranges.SetNum(NumMerged + 1, false);
+
+	//* Upload only the changed sub-regions of the buffers */
+	const uint32 PosStride = GetPointPosStride();
+	const uint32 ColorStride = GetPointColorStride();
+	for (const FPointRange& Range : Ranges)
+	{
+		void* PointPosBufferData = RHILockStructuredBuffer(m_PointPosDataBuffer, PosStride * Range.Start, PosStride * Range.Count, RLM_WriteOnly);
+		void* PointColorBufferData = RHILockStructuredBuffer(m_PointColorsDataBuffer, ColorStride * Range.Start, ColorStride * Range.Count, RLM_WriteOnly);
+		WritePointData(PointPosBufferData, PointColorBufferData, &PointPosData[Range.Start], &PointColorData[Range.Start], Range.Count);
+		RHIUnlockStructuredBuffer(m_PointPosDataBuffer);
+		RHIUnlockStructuredBuffer(m_PointColorsDataBuffer);
+	}
+
+	return true;
+}
+
+void FComputeShader::SetPointData(const FVector4* InPointPos, const FVector4* InPointColors, int32 Num)
+{
+	check(IsInGameThread());
+	check(InPointPos && InPointColors && Num > 0);
+
+	if (Num > NumElements)
+		SetNumElements(Num);
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_FOURPARAMETER(
+		FComputeShaderPointDataUpload,
+		FComputeShader*, ComputeShader, this,
+		const FVector4*, PointPos, InPointPos,
+		const FVector4*, PointColors, InPointColors,
+		int32, NumPoints, Num,
+		{
+		ComputeShader->UploadPointData(PointPos, PointColors, NumPoints);
+	}
+	);
+	PointDataUploadFence.BeginFence();
+}
+
+void FComputeShader::UploadPointData(const FVector4* InPointPos, const FVector4* InPointColors, int32 Num)
+{
+	check(IsInRenderingThread());
+
+	if (bIsUnloading)
+		return;
+
+	// The data arrays stay the current points: the CPU strategy sorts them, full uploads (payload mode, new resources) read them.
+	// Ranges recorded before are replaced as well.
+	FMemory::Memcpy(PointPosData.GetData(), InPointPos, sizeof(FVector4) * Num);
+	FMemory::Memcpy(PointColorData.GetData(), InPointColors, sizeof(FVector4) * Num);
+	FMemory::Memzero(PointPosData.GetData() + Num, sizeof(FVector4) * (PaddedNumElements - Num));
+	DirtyRanges.Reset();
+	bHasSortResult = false;
+
+	if (SortStrategy == ESortStrategy::CPU) {
+		bUpdateDataInShader = true;
+		return;
+	}
+
+	const uint32 PosStride = GetPointPosStride();
+	const uint32 ColorStride = GetPointColorStride();
+
+	//* Copy (or pack) straight from the caller's memory into the locked buffers, the points behind Num become invalid (zero) */
+	uint8* PointPosBufferData = (uint8*)RHILockStructuredBuffer(m_PointPosDataBuffer, 0, PosStride * PaddedNumElements, RLM_WriteOnly);
+	uint8* PointColorBufferData = (uint8*)RHILockStructuredBuffer(m_PointColorsDataBuffer, 0, ColorStride * PaddedNumElements, RLM_WriteOnly);
+	WritePointData(PointPosBufferData, PointColorBufferData, InPointPos, InPointColors, Num);
+	FMemory::Memzero(PointPosBufferData + PosStride * Num, PosStride * (PaddedNumElements - Num));
+	FMemory::Memzero(PointColorBufferData + ColorStride * Num, ColorStride * (PaddedNumElements - Num));
+	RHIUnlockStructuredBuffer(m_PointPosDataBuffer);
+	RHIUnlockStructuredBuffer(m_PointColorsDataBuffer);
+
+	// The buffers match the data arrays, the last order is meaningless now
+	bUpdateDataInShader = false;
+}
+
+template<typename TRHICmdList>
+void FComputeShader::ParallelBitonicSort(TRHICmdList& RHICmdList)
+{	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/// Parallel Bitonic Sort, adapted from https://code.msdn.microsoft.com/windowsdesktop/DirectCompute-Basic-Win32-7d5a7408
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	SCOPE_CYCLE_COUNTER(STAT_PointSort_ParallelBitonicSort);
+
+	//* Create Compute Shader */
+	TShaderMapRef<FComputeShaderDeclaration> ComputeShader(GetGlobalShaderMap(FeatureLevel), GetPointFormatPermutation());
+	TShaderMapRef<FComputeShaderTransposeDeclaration> ComputeShaderTranspose(GetGlobalShaderMap(FeatureLevel), GetPointFormatPermutation());
+	TShaderMapRef<FComputeShaderMergeDeclaration> ComputeShaderMerge(GetGlobalShaderMap(FeatureLevel), GetPointFormatPermutation());
+	TShaderMapRef<FComputeShaderLocalSortDeclaration> ComputeShaderLocalSort(GetGlobalShaderMap(FeatureLevel), GetPointFormatPermutation());
+
+	//* The passes only compare the precomputed keys */
+	GeneratePointKeys(RHICmdList);
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::Keys);
+
+	//* Pass input data to shader */
+	ComputeShader->SetPointPosData(RHICmdList, m_PointPosDataBuffer_UAV, m_PointPosDataBuffer_UAV2);
+	ComputeShader->SetPointColorData(RHICmdList, m_PointColorsDataBuffer_UAV, m_PointColorsDataBuffer_UAV2);
+	ComputeShader->SetPointKeys(RHICmdList, m_PointKeysBuffer_UAV, m_PointKeysBuffer_UAV2);
+
+	/////////////////////////////////////////////////////////////////////////
+	/////////////////////////////////////////////////////////////////////////
+
+	for (int32 PassIndex = 0; PassIndex < SortSchedule.Num(); ++PassIndex)
+	{
+		const FBitonicSortPass& Pass = SortSchedule[PassIndex];
+
+		switch (Pass.Type)
+		{
+		case EBitonicPassType::SortLocal:
+			// Sort the rows for all levels up to the block size
+			RHICmdList.SetComputeShader(ComputeShaderLocalSort->GetComputeShader());
+			ComputeShaderLocalSort->SetPointPosData(RHICmdList, m_PointPosDataBuffer_UAV, m_PointPosDataBuffer_UAV2);
+			ComputeShaderLocalSort->SetPointColorData(RHICmdList, m_PointColorsDataBuffer_UAV, m_PointColorsDataBuffer_UAV2);
+			ComputeShaderLocalSort->SetPointKeys(RHICmdList, m_PointKeysBuffer_UAV, m_PointKeysBuffer_UAV2);
+			ComputeShaderLocalSort->SetOutputTexture(RHICmdList, m_SortedPointPosTex_UAV[WriteOutputIndex]);
+			ComputeShaderLocalSort->SetPointColorTexture(RHICmdList, m_SortedPointColorsTex_UAV[WriteOutputIndex]);
+			ComputeShaderLocalSort->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+			ComputeShaderLocalSort->SetPass(RHICmdList, m_SortPassTableBuffer_SRV, PassIndex);
+			DispatchComputeShader(RHICmdList, *ComputeShaderLocalSort, Pass.ThreadGroupsX, Pass.ThreadGroupsY, 1);
+			ComputeShaderLocalSort->UnbindBuffers(RHICmdList);
+			ComputeShader->SetPointPosData(RHICmdList, m_PointPosDataBuffer_UAV, m_PointPosDataBuffer_UAV2);
+			ComputeShader->SetPointColorData(RHICmdList, m_PointColorsDataBuffer_UAV, m_PointColorsDataBuffer_UAV2);
+			ComputeShader->SetPointKeys(RHICmdList, m_PointKeysBuffer_UAV, m_PointKeysBuffer_UAV2);
+			break;
+
+		case EBitonicPassType::SortRows:
+			// Sort the row data
+			ComputeShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+			ComputeShader->SetPass(RHICmdList, m_SortPassTableBuffer_SRV, PassIndex);
+			ComputeShader->SetOutputTexture(RHICmdList, m_SortedPointPosTex_UAV[WriteOutputIndex]);
+			ComputeShader->SetPointColorTexture(RHICmdList, m_SortedPointColorsTex_UAV[WriteOutputIndex]);
+			RHICmdList.SetComputeShader(ComputeShader->GetComputeShader());
+			DispatchComputeShader(RHICmdList, *ComputeShader, Pass.ThreadGroupsX, Pass.ThreadGroupsY, 1);
+			break;
+
+		case EBitonicPassType::Transpose:
+			// Reads the second buffer (written by the previous row sort) into the first one, the buffers are still bound from the row sort
+			ComputeShaderTranspose->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+			ComputeShaderTranspose->SetPass(RHICmdList, m_SortPassTableBuffer_SRV, PassIndex);
+			RHICmdList.SetComputeShader(ComputeShaderTranspose->GetComputeShader());
+			DispatchComputeShader(RHICmdList, *ComputeShaderTranspose, Pass.ThreadGroupsX, Pass.ThreadGroupsY, 1);
+			break;
+
+		case EBitonicPassType::MergeGlobal:
+			// Compare-exchange directly in device memory
+			RHICmdList.SetComputeShader(ComputeShaderMerge->GetComputeShader());
+			ComputeShaderMerge->SetPointData(RHICmdList, m_PointPosDataBuffer_UAV, m_PointColorsDataBuffer_UAV, m_PointKeysBuffer_UAV);
+			ComputeShaderMerge->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+			ComputeShaderMerge->SetPass(RHICmdList, m_SortPassTableBuffer_SRV, PassIndex);
+			DispatchComputeShader(RHICmdList, *ComputeShaderMerge, Pass.ThreadGroupsX, Pass.ThreadGroupsY, 1);
+			ComputeShaderMerge->UnbindBuffers(RHICmdList);
+			ComputeShader->SetPointPosData(RHICmdList, m_PointPosDataBuffer_UAV, m_PointPosDataBuffer_UAV2);
+			ComputeShader->SetPointColorData(RHICmdList, m_PointColorsDataBuffer_UAV, m_PointColorsDataBuffer_UAV2);
+			ComputeShader->SetPointKeys(RHICmdList, m_PointKeysBuffer_UAV, m_PointKeysBuffer_UAV2);
+			break;
+		}
+
+		if (Pass.Type == EBitonicPassType::SortLocal)
+			GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::LocalSort);
+	}
+	ComputeShader->UnbindBuffers(RHICmdList);
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::GlobalSort);
+}
+
+template<typename TRHICmdList>
+void FComputeShader::IncrementalSort(TRHICmdList& RHICmdList)
+{
+	TShaderMapRef<FComputeShaderBlockSortDeclaration> BlockSortShader(GetGlobalShaderMap(FeatureLevel), GetPointFormatPermutation());
+
+	//* The data buffers still hold the order of the last sort, only the keys are new */
+	GeneratePointKeys(RHICmdList);
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::Keys);
+
+	RHICmdList.SetComputeShader(BlockSortShader->GetComputeShader());
+	BlockSortShader->SetPointPosData(RHICmdList, m_PointPosDataBuffer_UAV, m_PointPosDataBuffer_UAV2);
+	BlockSortShader->SetPointColorData(RHICmdList, m_PointColorsDataBuffer_UAV, m_PointColorsDataBuffer_UAV2);
+	BlockSortShader->SetPointKeys(RHICmdList, m_PointKeysBuffer_UAV, m_PointKeysBuffer_UAV2);
+	BlockSortShader->SetOutputTexture(RHICmdList, m_SortedPointPosTex_UAV[WriteOutputIndex]);
+	BlockSortShader->SetPointColorTexture(RHICmdList, m_SortedPointColorsTex_UAV[WriteOutputIndex]);
+
+	BlockSortShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+
+	//* Alternate between aligned and half-block shifted blocks (odd pass numbers), so the points can cross the block borders */
+	const int32 NumBlocks = PaddedNumElements / BITONIC_BLOCK_SIZE;
+	for (int32 Pass = 0; Pass < IncrementalNumFixupPasses; ++Pass)
+	{
+		const bool bShifted = (Pass & 1) != 0;
+		if (bShifted && NumBlocks == 1)
+			break;
+
+		BlockSortShader->SetBlockShift(RHICmdList, bShifted);
+		DispatchComputeShader(RHICmdList, *BlockSortShader, 1, bShifted ? NumBlocks - 1 : NumBlocks, 1);
+	}
+	BlockSortShader->UnbindBuffers(RHICmdList);
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::LocalSort);
+}
+
+template<typename TRHICmdList>
+void FComputeShader::IncrementalSortKeys(TRHICmdList& RHICmdList)
+{
+	TShaderMapRef<FComputeShaderKeyRefreshDeclaration> KeyRefreshShader(GetGlobalShaderMap(FeatureLevel), GetPointSortKeyPermutation());
+
+	const int32 NumBlocks = PaddedNumElements / BITONIC_BLOCK_SIZE;
+	FUnorderedAccessViewRHIRef SortKeysUAV = m_SortKeysBuffer_UAV[SortKeysResultIndex];
+
+	//* New keys for the current camera, in the order of the last sort */
+	RHICmdList.SetComputeShader(KeyRefreshShader->GetComputeShader());
+	KeyRefreshShader->SetPointData(RHICmdList, m_PointPosDataBuffer_SRV, m_PointColorsDataBuffer_SRV);
+	KeyRefreshShader->SetPointSegments(RHICmdList, m_PointSegmentsBuffer_SRV);
+	KeyRefreshShader->SetSortKeys(RHICmdList, SortKeysUAV, FUnorderedAccessViewRHIRef());
+	KeyRefreshShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+	DispatchComputeShader(RHICmdList, *KeyRefreshShader, 1, NumBlocks, 1);
+	KeyRefreshShader->UnbindBuffers(RHICmdList);
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::Keys);
+
+	BlockSortKeys(RHICmdList, IncrementalNumFixupPasses);
+}
+
+template<typename TRHICmdList>
+void FComputeShader::BlockSortKeys(TRHICmdList& RHICmdList, int32 NumPasses)
+{
+	TShaderMapRef<FComputeShaderKeyBlockSortDeclaration> KeyBlockSortShader(GetGlobalShaderMap(FeatureLevel));
+	const int32 NumBlocks = PaddedNumElements / BITONIC_BLOCK_SIZE;
+
+	//* Same block passes as IncrementalSort, on the pairs */
+	RHICmdList.SetComputeShader(KeyBlockSortShader->GetComputeShader());
+	KeyBlockSortShader->SetSortKeys(RHICmdList, m_SortKeysBuffer_UAV[SortKeysResultIndex], FUnorderedAccessViewRHIRef());
+	KeyBlockSortShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+	for (int32 Pass = 0; Pass < NumPasses; ++Pass)
+	{
+		const bool bShifted = (Pass & 1) != 0;
+		if (bShifted && NumBlocks == 1)
+			break;
+
+		KeyBlockSortShader->SetBlockShift(RHICmdList, bShifted);
+		DispatchComputeShader(RHICmdList, *KeyBlockSortShader, 1, bShifted ? NumBlocks - 1 : NumBlocks, 1);
+	}
+	KeyBlockSortShader->UnbindBuffers(RHICmdList);
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::LocalSort);
+}
+
+template<typename TRHICmdList>
+void FComputeShader::ViewOrderSortKeys(TRHICmdList& RHICmdList)
+{
+	TShaderMapRef<FComputeShaderLoadViewOrderDeclaration> LoadShader(GetGlobalShaderMap(FeatureLevel), GetPointSortKeyPermutation());
+
+	//* The cached direction closest to the direction from the center of the bounds to the camera (the bins of the view depth keys look at the center) */
+	FVector ViewDirection = (FVector(VariableParameters.CurrentCamPos) - ViewOrderBounds.GetCenter()).GetSafeNormal();
+	if (SortKey.Type == ESortKeyType::ViewDepth)
+		ViewDirection = -FVector(VariableParameters.CurrentViewDir);
+	const FViewOrderBin* ClosestBin = &ViewOrderBins[0];
+	for (const FViewOrderBin& Bin : ViewOrderBins) {
+		if ((Bin.Direction | ViewDirection) > (ClosestBin->Direction | ViewDirection))
+			ClosestBin = &Bin;
+	}
+
+	//* Its order with the keys of the current camera, instead of generating and sorting the keys */
+	RHICmdList.SetComputeShader(LoadShader->GetComputeShader());
+	LoadShader->SetPointData(RHICmdList, m_PointPosDataBuffer_SRV, m_PointColorsDataBuffer_SRV);
+	LoadShader->SetSortKeys(RHICmdList, m_SortKeysBuffer_UAV[SortKeysResultIndex], FUnorderedAccessViewRHIRef());
+	LoadShader->SetViewOrder(RHICmdList, ClosestBin->UAV);
+	LoadShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+	DispatchComputeShader(RHICmdList, *LoadShader, 1, PaddedNumElements / BITONIC_BLOCK_SIZE, 1);
+	LoadShader->UnbindBuffers(RHICmdList);
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::Keys);
+
+	//* The direction only approximates the camera, the fix-up passes correct the order locally */
+	if (ViewOrderNumFixupPasses > 0)
+		BlockSortKeys(RHICmdList, ViewOrderNumFixupPasses);
+}
+
+template<typename TRHICmdList>
+void FComputeShader::BuildViewOrderBins(TRHICmdList& RHICmdList)
+{
+	TShaderMapRef<FComputeShaderStoreViewOrderDeclaration> StoreShader(GetGlobalShaderMap(FeatureLevel));
+
+	if (!ConstantParametersBuffer)
+		ConstantParametersBuffer = FComputeShaderConstantParametersRef::CreateUniformBufferImmediate(ConstantParameters, UniformBuffer_MultiFrame);
+
+	//* The bins sort the whole cloud from cameras around the bounds, with the key buffers and the parameters of the frame */
+	const FComputeShaderVariableParameters FrameParameters = VariableParameters;
+	const FComputeShaderVariableParametersRef FrameParametersBuffer = VariableParametersBuffer;
+	const bool bFrameCullPoints = bCullPoints;
+	bCullPoints = false;
+	VariableParameters.g_iRadixNumGroups = FMath::DivideAndRoundUp<int32>(NumElements, RADIX_BLOCK_SIZE);
+	GPUTimer.SuspendMarks();
+
+	const FVector Center = ViewOrderBounds.GetCenter();
+	const float CameraDistance = ViewOrderBounds.GetExtent().Size() * VIEW_ORDER_CAMERA_DISTANCE;
+	int32 NumBuilt = 0;
+	for (FViewOrderBin& Bin : ViewOrderBins)
+	{
+		if (Bin.bValid)
+			continue;
+		if (NumBuilt == VIEW_ORDER_BINS_PER_EXECUTION)
+			break;
+
+		// 4 bytes per point, allocated when the bin is built first
+		if (!Bin.Buffer || Bin.Buffer->GetSize() != sizeof(uint32) * PaddedNumElements) {
+			FRHIResourceCreateInfo CreateInfo;
+			Bin.Buffer = RHICreateStructuredBuffer(sizeof(uint32), sizeof(uint32) * PaddedNumElements, BUF_UnorderedAccess | BUF_ShaderResource, CreateInfo);
+			Bin.UAV = RHICreateUnorderedAccessView(Bin.Buffer, false, false);
+		}
+
+		VariableParameters.CurrentCamPos = FVector4(Center + Bin.Direction * CameraDistance, 1.0f);
+		VariableParameters.CurrentViewDir = FVector4(-Bin.Direction, 0.0f);
+		VariableParametersBuffer = FComputeShaderVariableParametersRef::CreateUniformBufferImmediate(VariableParameters, UniformBuffer_SingleFrame);
+
+		if (SortStrategy == ESortStrategy::Radix)
+			ParallelRadixSortKeys(RHICmdList);
+		else
+			ParallelBitonicSortKeys(RHICmdList);
+
+		RHICmdList.SetComputeShader(StoreShader->GetComputeShader());
+		StoreShader->SetSortKeys(RHICmdList, m_SortKeysBuffer_UAV[SortKeysResultIndex], FUnorderedAccessViewRHIRef());
+		StoreShader->SetViewOrder(RHICmdList, Bin.UAV);
+		StoreShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+		DispatchComputeShader(RHICmdList, *StoreShader, 1, PaddedNumElements / BITONIC_BLOCK_SIZE, 1);
+		StoreShader->UnbindBuffers(RHICmdList);
+
+		Bin.bValid = true;
+		NumViewOrderBinsBuilt.Increment();
+		++NumBuilt;
+	}
+
+	GPUTimer.ResumeMarks();
+	VariableParameters = FrameParameters;
+	VariableParametersBuffer = FrameParametersBuffer;
+	bCullPoints = bFrameCullPoints;
+	bSortKeysHoldLastOrder = false;
+}
+
+template<typename TRHICmdList>
+void FComputeShader::GeneratePointKeys(TRHICmdList& RHICmdList)
+{
+	TShaderMapRef<FComputeShaderPointKeyGenDeclaration> PointKeyGenShader(GetGlobalShaderMap(FeatureLevel), GetPointSortKeyPermutation());
+
+	//* One key per point for the current camera, in the current order of the data buffers */
+	RHICmdList.SetComputeShader(PointKeyGenShader->GetComputeShader());
+	PointKeyGenShader->SetPointPosData(RHICmdList, m_PointPosDataBuffer_UAV, FUnorderedAccessViewRHIRef());
+	PointKeyGenShader->SetPointColorData(RHICmdList, m_PointColorsDataBuffer_UAV, FUnorderedAccessViewRHIRef());
+	PointKeyGenShader->SetPointKeys(RHICmdList, m_PointKeysBuffer_UAV, FUnorderedAccessViewRHIRef());
+	PointKeyGenShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+	DispatchComputeShader(RHICmdList, *PointKeyGenShader, 1, PaddedNumElements / BITONIC_BLOCK_SIZE, 1);
+	PointKeyGenShader->UnbindBuffers(RHICmdList);
+}
+
+template<typename TRHICmdList>
+void FComputeShader::GenerateSortKeys(TRHICmdList& RHICmdList)
+{
+	if (bCullPoints) {
+		CullSortKeys(RHICmdList);
+		return;
+	}
+
+	TShaderMapRef<FComputeShaderKeyGenDeclaration> KeyGenShader(GetGlobalShaderMap(FeatureLevel), GetPointSortKeyPermutation());
+
+	//* Emit one (distance key, point index) pair per point into the first key buffer */
+	RHICmdList.SetComputeShader(KeyGenShader->GetComputeShader());
+	KeyGenShader->SetPointData(RHICmdList, m_PointPosDataBuffer_SRV, m_PointColorsDataBuffer_SRV);
+	KeyGenShader->SetPointSegments(RHICmdList, m_PointSegmentsBuffer_SRV);
+	KeyGenShader->SetSortKeys(RHICmdList, m_SortKeysBuffer_UAV[0], FUnorderedAccessViewRHIRef());
+	KeyGenShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+	DispatchComputeShader(RHICmdList, *KeyGenShader, 1, PaddedNumElements / BITONIC_BLOCK_SIZE, 1);
+	KeyGenShader->UnbindBuffers(RHICmdList);
+}
+
+template<typename TRHICmdList>
+void FComputeShader::CullSortKeys(TRHICmdList& RHICmdList)
+{
+	TShaderMapRef<FComputeShaderCullDeclaration> CullShader(GetGlobalShaderMap(FeatureLevel), GetPointSortKeyPermutation());
+	TShaderMapRef<FComputeShaderCullScanDeclaration> CullScanShader(GetGlobalShaderMap(FeatureLevel));
+	TShaderMapRef<FComputeShaderCullScatterDeclaration> CullScatterShader(GetGlobalShaderMap(FeatureLevel));
+	const uint32 NumGroups = PaddedNumElements / BITONIC_BLOCK_SIZE;
+
+	//* Pairs with the keys of the visible points into the second key buffer, counted per group */
+	RHICmdList.SetComputeShader(CullShader->GetComputeShader());
+	CullShader->SetPointData(RHICmdList, m_PointPosDataBuffer_SRV, m_PointColorsDataBuffer_SRV);
+	CullShader->SetSortKeys(RHICmdList, FUnorderedAccessViewRHIRef(), m_SortKeysBuffer_UAV[1]);
+	CullShader->SetCullBuffers(RHICmdList, m_CullCountersBuffer_UAV, FUnorderedAccessViewRHIRef());
+	CullShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+	DispatchComputeShader(RHICmdList, *CullShader, 1, NumGroups, 1);
+	CullShader->UnbindBuffers(RHICmdList);
+
+	//* Output offsets of the groups, the live count and the dispatch arguments for the radix sort. The arguments were left readable by the last culled sort */
+	RHICmdList.TransitionResource(EResourceTransitionAccess::EWritable, EResourceTransitionPipeline::EComputeToCompute, m_CullDispatchArgsBuffer_UAV);
+	RHICmdList.SetComputeShader(CullScanShader->GetComputeShader());
+	CullScanShader->SetCullBuffers(RHICmdList, m_CullCountersBuffer_UAV, m_CullDispatchArgsBuffer_UAV);
+	CullScanShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+	DispatchComputeShader(RHICmdList, *CullScanShader, 1, 1, 1);
+	CullScanShader->UnbindBuffers(RHICmdList);
+
+	//* Compact the pairs into the first key buffer, where the sorts start */
+	RHICmdList.SetComputeShader(CullScatterShader->GetComputeShader());
+	CullScatterShader->SetSortKeys(RHICmdList, m_SortKeysBuffer_UAV[0], m_SortKeysBuffer_UAV[1]);
+	CullScatterShader->SetCullBuffers(RHICmdList, m_CullCountersBuffer_UAV, FUnorderedAccessViewRHIRef());
+	CullScatterShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+	DispatchComputeShader(RHICmdList, *CullScatterShader, 1, NumGroups, 1);
+	CullScatterShader->UnbindBuffers(RHICmdList);
+
+	// The dispatch arguments are read as indirect arguments and SRV from now on
+	RHICmdList.TransitionResource(EResourceTransitionAccess::EReadable, EResourceTransitionPipeline::EComputeToCompute, m_CullDispatchArgsBuffer_UAV);
+}
+
+template<typename TRHICmdList>
+void FComputeShader::GatherSortedPoints(TRHICmdList& RHICmdList, int32 SortKeysBufferIndex)
+{
+	TShaderMapRef<FComputeShaderGatherDeclaration> GatherShader(GetGlobalShaderMap(FeatureLevel), GetPointFormatPermutation());
+
+	//* Write the sorted points to the output textures */
+	RHICmdList.SetComputeShader(GatherShader->GetComputeShader());
+	GatherShader->SetPointData(RHICmdList, m_PointPosDataBuffer_SRV, m_PointColorsDataBuffer_SRV);
+	GatherShader->SetSortKeys(RHICmdList, m_SortKeysBuffer_UAV[SortKeysBufferIndex], FUnorderedAccessViewRHIRef());
+	GatherShader->SetOutputTextures(RHICmdList, m_SortedPointPosTex_UAV[WriteOutputIndex], m_SortedPointColorsTex_UAV[WriteOutputIndex]);
+	GatherShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+	DispatchComputeShader(RHICmdList, *GatherShader, 1, PaddedNumElements / BITONIC_BLOCK_SIZE, 1);
+	GatherShader->UnbindBuffers(RHICmdList);
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::Output);
+}
+
+template<typename TRHICmdList>
+void FComputeShader::ParallelBitonicSortKeys(TRHICmdList& RHICmdList)
+{
+	TShaderMapRef<FComputeShaderKeySortDeclaration> KeySortShader(GetGlobalShaderMap(FeatureLevel));
+	TShaderMapRef<FComputeShaderKeyLocalSortDeclaration> KeyLocalSortShader(GetGlobalShaderMap(FeatureLevel));
+	TShaderMapRef<FComputeShaderKeyTransposeDeclaration> KeyTransposeShader(GetGlobalShaderMap(FeatureLevel));
+	TShaderMapRef<FComputeShaderKeyMergeDeclaration> KeyMergeShader(GetGlobalShaderMap(FeatureLevel));
+
+	GenerateSortKeys(RHICmdList);
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::Keys);
+
+	//* Sort the pairs, the transposes swap the buffer that holds the current data */
+	int32 Current = 0;
+	for (int32 PassIndex = 0; PassIndex < SortSchedule.Num(); ++PassIndex)
+	{
+		const FBitonicSortPass& Pass = SortSchedule[PassIndex];
+
+		FComputeShaderKeyIndexDeclaration* Shader = nullptr;
+		switch (Pass.Type)
+		{
+		case EBitonicPassType::SortLocal:	Shader = *KeyLocalSortShader; break;
+		case EBitonicPassType::SortRows:	Shader = *KeySortShader; break;
+		case EBitonicPassType::Transpose:	Shader = *KeyTransposeShader; break;
+		case EBitonicPassType::MergeGlobal:	Shader = *KeyMergeShader; break;
+		}
+
+		RHICmdList.SetComputeShader(Shader->GetComputeShader());
+		Shader->SetSortKeys(RHICmdList, m_SortKeysBuffer_UAV[Current], m_SortKeysBuffer_UAV[1 - Current]);
+		Shader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+		Shader->SetPass(RHICmdList, m_SortPassTableBuffer_SRV, PassIndex);
+		DispatchComputeShader(RHICmdList, Shader, Pass.ThreadGroupsX, Pass.ThreadGroupsY, 1);
+		Shader->UnbindBuffers(RHICmdList);
+
+		if (Pass.Type == EBitonicPassType::Transpose)
+			Current = 1 - Current;
+		if (Pass.Type == EBitonicPassType::SortLocal)
+			GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::LocalSort);
+	}
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::GlobalSort);
+
+	SortKeysResultIndex = Current;
+}
+
+// Dispatches one thread group per block of pairs, NumGroups = 0 takes the group count the culling wrote to the dispatch arguments
+template<typename TRHICmdList>
+void FComputeShader::DispatchRadixGroups(TRHICmdList& RHICmdList, FComputeShaderRadixDeclaration* Shader, uint32 NumGroups)
+{
+	if (NumGroups > 0)
+		DispatchComputeShader(RHICmdList, Shader, NumGroups, 1, 1);
+	else
+		RHICmdList.DispatchIndirectComputeShader(m_CullDispatchArgsBuffer, 0);
+}
+
+template<typename TRHICmdList>
+void FComputeShader::ParallelRadixSortKeys(TRHICmdList& RHICmdList)
+{
+	TShaderMapRef<FComputeShaderRadixHistogramDeclaration> HistogramShader(GetGlobalShaderMap(FeatureLevel));
+	TShaderMapRef<FComputeShaderRadixPrefixScanDeclaration> PrefixScanShader(GetGlobalShaderMap(FeatureLevel));
+	TShaderMapRef<FComputeShaderRadixScatterDeclaration> ScatterShader(GetGlobalShaderMap(FeatureLevel));
+
+	GenerateSortKeys(RHICmdList);
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::Keys);
+
+	// Only the groups containing actual points are sorted, the pairs behind them keep the padding indices from the key generation.
+	// After culling, only the groups of the visible points are sorted: their number is only known on the GPU (g_iRadixNumGroups = 0),
+	// so the dispatches are indirect.
+	const uint32 NumGroups = VariableParameters.g_iRadixNumGroups;
+
+	int32 Current = 0;
+	for (uint32 Pass = 0; Pass < RADIX_NUM_PASSES; ++Pass)
+	{
+		// Count the digits of each group
+		RHICmdList.SetComputeShader(HistogramShader->GetComputeShader());
+		HistogramShader->SetBuffers(RHICmdList, m_SortKeysBuffer_UAV[Current], FUnorderedAccessViewRHIRef(), m_RadixCountersBuffer_UAV);
+		HistogramShader->SetDispatchArgs(RHICmdList, m_CullDispatchArgsBuffer_SRV);
+		HistogramShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+		HistogramShader->SetRadixPass(RHICmdList, Pass);
+		DispatchRadixGroups(RHICmdList, *HistogramShader, NumGroups);
+		HistogramShader->UnbindBuffers(RHICmdList);
+
+		// Turn the counts into output offsets
+		RHICmdList.SetComputeShader(PrefixScanShader->GetComputeShader());
+		PrefixScanShader->SetBuffers(RHICmdList, FUnorderedAccessViewRHIRef(), FUnorderedAccessViewRHIRef(), m_RadixCountersBuffer_UAV);
+		PrefixScanShader->SetDispatchArgs(RHICmdList, m_CullDispatchArgsBuffer_SRV);
+		PrefixScanShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+		DispatchComputeShader(RHICmdList, *PrefixScanShader, 1, 1, 1);
+		PrefixScanShader->UnbindBuffers(RHICmdList);
+
+		// Move the pairs to the other buffer
+		RHICmdList.SetComputeShader(ScatterShader->GetComputeShader());
+		ScatterShader->SetBuffers(RHICmdList, m_SortKeysBuffer_UAV[Current], m_SortKeysBuffer_UAV[1 - Current], m_RadixCountersBuffer_UAV);
+		ScatterShader->SetDispatchArgs(RHICmdList, m_CullDispatchArgsBuffer_SRV);
+		ScatterShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+		ScatterShader->SetRadixPass(RHICmdList, Pass);
+		DispatchRadixGroups(RHICmdList, *ScatterShader, NumGroups);
+		ScatterShader->UnbindBuffers(RHICmdList);
+
+		Current = 1 - Current;
+	}
+	GPUTimer.MarkPhaseEnd(RHICmdList, EPointSortPhase::GlobalSort);
+
+	// RADIX_NUM_PASSES is even, so the result ends up in the first buffer, next to the untouched padding pairs
+	static_assert(RADIX_NUM_PASSES % 2 == 0, "The radix sort result is expected in the first key buffer");
+	SortKeysResultIndex = Current;
+}
+
+void FComputeShader::SortOnCPU()
+{
+	SCOPE_CYCLE_COUNTER(STAT_PointSort_CPU);
+	const uint32 SizeX = m_SortedPointPosTex[WriteOutputIndex]->GetSizeX();
+	const uint32 SizeY = m_SortedPointPosTex[WriteOutputIndex]->GetSizeY();
+
+	//* Sort on all cores, the result is already in the texel layout of the output textures */
+	CPUSort.SortPoints(PointPosData.GetData(), PointColorData.GetData(), NumElements, SizeX, SizeY, VariableParameters.CurrentCamPos, VariableParameters.CurrentViewDir, SortKey);
+
+	const FUpdateTextureRegion2D Region(0, 0, 0, 0, SizeX, SizeY);
+	RHIUpdateTexture2D(m_SortedPointPosTex[WriteOutputIndex], 0, Region, SizeX * sizeof(FVector4), (const uint8*)CPUSort.GetSortedPointPos().GetData());
+	RHIUpdateTexture2D(m_SortedPointColorsTex[WriteOutputIndex], 0, Region, SizeX * sizeof(FVector4), (const uint8*)CPUSort.GetSortedPointColors().GetData());
+}
+
+FVector4 FSortedPointReadback::GetTexelPos(int32 X, int32 Y) const
+{
+	const int32 Texel = Y * SizeX + X;
+
+	if (PointFormat == EPointFormat::Compact)
+	{
+		// PF_A16B16G16R16: the normalized position in RGB, the valid flag in alpha
+		const uint16* Packed = reinterpret_cast<const uint16*>(Texels.GetData()) + Texel * 4;
+		if (Packed[3] == 0)
+			return FVector4(0.0f, 0.0f, 0.0f, 0.0f);
+		return FVector4(BoundsMin + FVector(Packed[0], Packed[1], Packed[2]) / 65535.0f * BoundsSize, 1.0f);
+	}
+	return reinterpret_cast<const FVector4*>(Texels.GetData())[Texel];
+}
+
+bool FComputeShader::CopySortedPointsToRenderTargets(UTextureRenderTarget2D* PointPosRT, UTextureRenderTarget2D* PointColorsRT)
+{
+	check(IsInGameThread());
+
+	if (bIsUnloading || !PointPosRT || !PointColorsRT)
+		return false;
+
+	//* A plain copy needs the same size and format, e.g. RTF_RGBA32f for the float format */
+	auto Matches = [](UTextureRenderTarget2D* RenderTarget, FTexture2DRHIRef Texture)
+	{
+		return Texture && RenderTarget->SizeX == Texture->GetSizeX() && RenderTarget->SizeY == Texture->GetSizeY() && RenderTarget->GetFormat() == Texture->GetFormat();
+	};
+	if (!Matches(PointPosRT, m_SortedPointPosTex[0]) || !Matches(PointColorsRT, m_SortedPointColorsTex[0]))
+		return false;
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_THREEPARAMETER(
+		FComputeShaderCopyToRenderTargets,
+		FComputeShader*, ComputeShader, this,
+		FTextureRenderTargetResource*, PointPosTarget, PointPosRT->GameThread_GetRenderTargetResource(),
+		FTextureRenderTargetResource*, PointColorsTarget, PointColorsRT->GameThread_GetRenderTargetResource(),
+		{
+		// The latest published result, the sort may still be writing the other set
+		if (ComputeShader->bHasPublishedResult) {
+			RHICmdList.CopyToResolveTarget(ComputeShader->GetSortedPointPosTexture(), PointPosTarget->GetRenderTargetTexture(), FResolveParams());
+			RHICmdList.CopyToResolveTarget(ComputeShader->GetSortedPointColorsTexture(), PointColorsTarget->GetRenderTargetTexture(), FResolveParams());
+		}
+	}
+	);
+	return true;
+}
+
+void FComputeShader::RequestSortedPointReadback(FOnSortedPointReadback Callback)
+{
+	if (bIsUnloading)
+		return;
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
+		FComputeShaderPointReadback,
+		FComputeShader*, ComputeShader, this,
+		FOnSortedPointReadback, ReadbackCallback, Callback,
+		{
+		ComputeShader->PendingPointReadbacks.Add(ReadbackCallback);
+		ComputeShader->UpdatePointReadbacks(RHICmdList);
+		ComputeShader->UpdatePendingGPUWork();
+	}
+	);
+}
+
+void FComputeShader::UpdatePointReadbacks(FRHICommandListImmediate& RHICmdList)
+{
+	check(IsInRenderingThread());
+
+	//* Hand the copies the GPU is done with to the game thread, the fence has passed so the map doesn't wait */
+	for (FPointReadbackSlot& Slot : PointReadbacks)
+	{
+		if (!Slot.bInFlight || !Slot.Fence->Poll())
+			continue;
+
+		FSortedPointReadback& Result = *Slot.Result;
+		const int32 TexelSize = Result.PointFormat == EPointFormat::Compact ? sizeof(uint16) * 4 : sizeof(FVector4);
+		const int32 RowSize = Result.SizeX * TexelSize;
+
+		void* Data = nullptr;
+		int32 MappedWidth = 0, MappedHeight = 0;
+		RHICmdList.MapStagingSurface(Slot.StagingTex, Data, MappedWidth, MappedHeight);
+		if (Data) {
+			// The rows of the staging texture may be padded (MappedWidth is the row pitch in texels)
+			Result.Texels.SetNumUninitialized(RowSize * Result.SizeY);
+			for (int32 Row = 0; Row < Result.SizeY; ++Row)
+				FMemory::Memcpy(&Result.Texels[Row * RowSize], (const uint8*)Data + Row * MappedWidth * TexelSize, RowSize);
+		}
+		RHICmdList.UnmapStagingSurface(Slot.StagingTex);
+
+		TSharedPtr<FSortedPointReadback, ESPMode::ThreadSafe> ReadbackResult = Slot.Result;
+		FOnSortedPointReadback Callback = MoveTemp(Slot.Callback);
+		AsyncTask(ENamedThreads::GameThread, [ReadbackResult, Callback]()
+		{
+			Callback(*ReadbackResult);
+		});
+
+		Slot.Result.Reset();
+		Slot.Callback = nullptr;
+		Slot.Fence.SafeRelease();
+		Slot.bInFlight = false;
+	}
+
+	//* Copy the published result for the waiting requests into the free staging textures */
+	if (!bHasPublishedResult)
+		return;
+
+	FTexture2DRHIRef SortedPointPosTex = GetSortedPointPosTexture();
+	const uint32 SizeX = SortedPointPosTex->GetSizeX();
+	const uint32 SizeY = SortedPointPosTex->GetSizeY();
+	const EPixelFormat Format = SortedPointPosTex->GetFormat();
+
+	for (FPointReadbackSlot& Slot : PointReadbacks)
+	{
+		if (PendingPointReadbacks.Num() == 0)
+			break;
+		if (Slot.bInFlight)
+			continue;
+
+		if (!Slot.StagingTex || Slot.StagingTex->GetSizeX() != SizeX || Slot.StagingTex->GetSizeY() != SizeY || Slot.StagingTex->GetFormat() != Format) {
+			FRHIResourceCreateInfo CreateInfo;
+			Slot.StagingTex = RHICreateTexture2D(SizeX, SizeY, Format, 1, 1, TexCreate_CPUReadback, CreateInfo);
+		}
+
+		RHICmdList.CopyToResolveTarget(SortedPointPosTex, Slot.StagingTex, FResolveParams());
+		Slot.Fence = RHICreateGPUFence(FName(TEXT("PointSortReadback")));
+		RHICmdList.WriteGPUFence(Slot.Fence);
+
+		Slot.Result = MakeShared<FSortedPointReadback, ESPMode::ThreadSafe>();
+		Slot.Result->SizeX = SizeX;
+		Slot.Result->SizeY = SizeY;
+		Slot.Result->NumPoints = NumElements;
+		Slot.Result->PointFormat = Format == PF_A16B16G16R16 ? EPointFormat::Compact : EPointFormat::Float32;
+		Slot.Result->BoundsMin = FVector(ConstantParameters.PointBoundsMin);
+		Slot.Result->BoundsSize = FVector(ConstantParameters.PointBoundsSize);
+
+		Slot.Callback = PendingPointReadbacks[0];
+		PendingPointReadbacks.RemoveAt(0);
+		Slot.bInFlight = true;
+	}
+}
+
+void FComputeShader::ReleasePointReadbacks()
+{
+	for (FPointReadbackSlot& Slot : PointReadbacks)
+	{
+		Slot.StagingTex.SafeRelease();
+		Slot.Fence.SafeRelease();
+		Slot.Result.Reset();
+		Slot.Callback = nullptr;
+		Slot.bInFlight = false;
+	}
+	PendingPointReadbacks.Empty();
+}
+
+static bool IsValidPointPos(const FVector4& Pos)
+{
+	return Pos.X != 0.0f || Pos.Y != 0.0f || Pos.Z != 0.0f;
+}
+
+// Writes the positions as colors within their bounds, invalid points are black
+static void SaveSortedPointsBitmap(const FSortedPointReadback& Readback)
+{
+	if (Readback.Texels.Num() == 0) {
+		UE_LOG(LogConsoleResponse, Error, TEXT("Failed to save BMP, the sorted points could not be read back"));
+		return;
+	}
+
+	FBox Bounds(ForceInit);
+	for (int32 Y = 0; Y < Readback.SizeY; ++Y)
+		for (int32 X = 0; X < Readback.SizeX; ++X)
+			if (IsValidPointPos(Readback.GetTexelPos(X, Y)))
+				Bounds += FVector(Readback.GetTexelPos(X, Y));
+
+	const FVector InvSize = Bounds.IsValid ? FVector(1.0f) / Bounds.GetSize().ComponentMax(FVector(KINDA_SMALL_NUMBER)) : FVector(1.0f);
+
+	TArray<FColor> Bitmap;
+	Bitmap.Reserve(Readback.SizeX * Readback.SizeY);
+	for (int32 Y = 0; Y < Readback.SizeY; ++Y)
+	{
+		for (int32 X = 0; X < Readback.SizeX; ++X)
+		{
+			const FVector4 Pos = Readback.GetTexelPos(X, Y);
+			const FVector Normalized = IsValidPointPos(Pos) ? (FVector(Pos) - Bounds.Min) * InvSize : FVector::ZeroVector;
+			Bitmap.Add(FLinearColor(Normalized.X, Normalized.Y, Normalized.Z, 1.0f).ToFColor(false));
+		}
+	}
+
+	// Create screenshot folder if not already present.
+	IFileManager::Get().MakeDirectory(*FPaths::ScreenShotDir(), true);
+
+	const FString ScreenFileName(FPaths::ScreenShotDir() / TEXT("VisualizeTexture"));
+
+	// Save the contents of the array to a bitmap file. (24bit only so alpha channel is dropped)
+	FFileHelper::CreateBitmap(*ScreenFileName, Readback.SizeX, Readback.SizeY, Bitmap.GetData());
+
+	UE_LOG(LogConsoleResponse, Display, TEXT("Content was saved to \"%s\""), *FPaths::ScreenShotDir());
+}
+
+void FComputeShader::Save()
+{
+	RequestSortedPointReadback(&SaveSortedPointsBitmap);
 }
@@ -0,0 +1,63 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/***************************************************************************/
+/* CPU side of the compact point format (see PointFormat.ush): positions   */
+/* quantized to 16 bit per component relative to the cloud bounds and     */
+/* RGBA8 colors.                                                           */
+/***************************************************************************/
+
+// Quantized position: x | y << 16 and z | valid flag << 16
+struct FPackedPointPos
+{
+	uint32 XY;
+	uint32 ZW;
+};
+
+// Packs a position, points with a zero position are invalid (like the padding of the float format)
+FORCEINLINE FPackedPointPos PackPointPos(const FVector4& Pos, const FVector& BoundsMin, const FVector& InvBoundsSize)
+{
+	if (Pos.X == 0.0f && Pos.Y == 0.0f && Pos.Z == 0.0f)
+		return FPackedPointPos{ 0, 0 };
+
+	const FVector Normalized = ((FVector(Pos) - BoundsMin) * InvBoundsSize).BoundToBox(FVector::ZeroVector, FVector(1.0f));
+	const uint32 X = FMath::RoundToInt(Normalized.X * 65535.0f);
+	const uint32 Y = FMath::RoundToInt(Normalized.Y * 65535.0f);
+	const uint32 Z = FMath::RoundToInt(Normalized.Z * 65535.0f);
+
+	return FPackedPointPos{ X | (Y << 16), Z | (0xFFFF << 16) };
+}
+
+// Packs a linear color to RGBA8, R in the lowest byte
+FORCEINLINE uint32 PackPointColor(const FVector4& Color)
+{
+	const FColor Quantized = FLinearColor(Color.X, Color.Y, Color.Z, Color.W).QuantizeRound();
+	return (uint32)Quantized.R | ((uint32)Quantized.G << 8) | ((uint32)Quantized.B << 16) | ((uint32)Quantized.A << 24);
+}
@@ -0,0 +1,276 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+#include "ComputeShaderPrivatePCH.h"
+#include "PointSortBenchmark.h"
+#include "ComputeShaderCPUSort.h"
+
+DEFINE_LOG_CATEGORY(LogPointSortBenchmark);
+
+// Bytes per element the payload bitonic sort moves: the key, the float4 position and the float4 color
+const uint32 PAYLOAD_ELEMENT_SIZE = sizeof(uint32) + sizeof(FVector4) * 2;
+
+const TCHAR* GetPointSortBenchmarkInputName(EPointSortBenchmarkInput Input)
+{
+	switch (Input)
+	{
+	case EPointSortBenchmarkInput::Uniform:			return TEXT("Uniform");
+	case EPointSortBenchmarkInput::Clustered:		return TEXT("Clustered");
+	case EPointSortBenchmarkInput::Sorted:			return TEXT("Sorted");
+	case EPointSortBenchmarkInput::PreviousFrame:	return TEXT("PreviousFrame");
+	default:										return TEXT("Unknown");
+	}
+}
+
+/************************************************************************/
+/* The sorting routines and their cost on the GPU (or the CPU)          */
+/************************************************************************/
+static void SortBitonicTranspose(TArray<FSortKeyIndex>& Keys, TArray<FSortKeyIndex>& Scratch)
+{
+	FComputeShaderReference::BitonicSort(Keys, EBitonicScheduleType::Transpose, 0);
+}
+
+static void SortBitonicGlobalMerge(TArray<FSortKeyIndex>& Keys, TArray<FSortKeyIndex>& Scratch)
+{
+	FComputeShaderReference::BitonicSort(Keys, EBitonicScheduleType::GlobalMerge, 0);
+}
+
+static void SortRadix(TArray<FSortKeyIndex>& Keys, TArray<FSortKeyIndex>& Scratch)
+{
+	FComputeShaderReference::RadixSort(Keys);
+}
+
+static void SortCPU(TArray<FSortKeyIndex>& Keys, TArray<FSortKeyIndex>& Scratch)
+{
+	FComputeShaderCPUSort::ParallelRadixSort(Keys.GetData(), Scratch.GetData(), Keys.Num());
+}
+
+static void GetBitonicCost(EBitonicScheduleType ScheduleType, uint32 NumElements, FPointSortBenchmarkResult& Result)
+{
+	TArray<FBitonicSortPass> Passes;
+	BuildBitonicSortSchedule(NumElements, Passes, ScheduleType);
+
+	const FBitonicSortScheduleCost KeyIndexCost = GetBitonicSortScheduleCost(Passes, NumElements, sizeof(FSortKeyIndex));
+	const FBitonicSortScheduleCost PayloadCost = GetBitonicSortScheduleCost(Passes, NumElements, PAYLOAD_ELEMENT_SIZE);
+	Result.NumPasses = KeyIndexCost.NumDispatches;
+	Result.BytesMoved = KeyIndexCost.BytesRead + KeyIndexCost.BytesWritten;
+	Result.PayloadBytesMoved = PayloadCost.BytesRead + PayloadCost.BytesWritten;
+}
+
+static void GetBitonicTransposeCost(uint32 NumElements, FPointSortBenchmarkResult& Result)
+{
+	GetBitonicCost(EBitonicScheduleType::Transpose, NumElements, Result);
+}
+
+static void GetBitonicGlobalMergeCost(uint32 NumElements, FPointSortBenchmarkResult& Result)
+{
+	GetBitonicCost(EBitonicScheduleType::GlobalMerge, NumElements, Result);
+}
+
+static void GetRadixCost(uint32 NumElements, FPointSortBenchmarkResult& Result)
+{
+	// Per pass: the histogram reads the pairs, the scatter reads and writes them. The counters are written, scanned and read again.
+	const uint64 DataSize = (uint64)NumElements * sizeof(FSortKeyIndex);
+	const uint64 CountersSize = (uint64)(NumElements / RADIX_BLOCK_SIZE) * RADIX_SIZE * sizeof(uint32);
+	Result.NumPasses = RADIX_NUM_PASSES * 3;
+	Result.BytesMoved = RADIX_NUM_PASSES * (DataSize * 3 + CountersSize * 4);
+	Result.PayloadBytesMoved = 0;
+}
+
+static void GetCPUCost(uint32 NumElements, FPointSortBenchmarkResult& Result)
+{
+	// Per pass: counting and scattering read the pairs, the scatter writes them
+	Result.NumPasses = CPU_RADIX_NUM_PASSES;
+	Result.BytesMoved = CPU_RADIX_NUM_PASSES * (uint64)NumElements * sizeof(FSortKeyIndex) * 3;
+	Result.PayloadBytesMoved = 0;
+}
+
+struct FPointSortBenchmarkBackend
+{
+	const TCHAR* Name;
+	void(*Sort)(TArray<FSortKeyIndex>& Keys, TArray<FSortKeyIndex>& Scratch);
+	void(*GetCost)(uint32 NumElements, FPointSortBenchmarkResult& Result);
+};
+
+static const FPointSortBenchmarkBackend BenchmarkBackends[] =
+{
+	{ TEXT("BitonicTranspose"),		&SortBitonicTranspose,		&GetBitonicTransposeCost },
+	{ TEXT("BitonicGlobalMerge"),	&SortBitonicGlobalMerge,	&GetBitonicGlobalMergeCost },
+	{ TEXT("Radix"),				&SortRadix,					&GetRadixCost },
+	{ TEXT("CPU"),					&SortCPU,					&GetCPUCost },
+};
+
+void FPointSortBenchmark::GenerateInput(EPointSortBenchmarkInput Input, int32 NumElements, int32 Seed, TArray<FSortKeyIndex>& OutKeys)
+{
+	const float Extent = 1000.0f;
+	const FVector4 CamPos(Extent * 1.5f, 0.0f, 0.0f, 0.0f);
+	FRandomStream Random(Seed + (int32)Input);
+
+	TArray<FVector4> PointPos;
+	PointPos.SetNumUninitialized(NumElements);
+
+	if (Input == EPointSortBenchmarkInput::Clustered)
+	{
+		//* Consecutive points belong to the same cluster, like the points of one scan position */
+		const int32 NumClusters = 32;
+		const float Sigma = 25.0f;
+		FVector ClusterCenter;
+		for (int32 i = 0; i < NumElements; ++i)
+		{
+			if (i % FMath::DivideAndRoundUp(NumElements, NumClusters) == 0)
+				ClusterCenter = FVector(Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent));
+
+			// Sum of three uniform numbers, close enough to a normal distribution
+			auto Offset = [&Random, Sigma]() { return (Random.FRand() + Random.FRand() + Random.FRand() - 1.5f) * Sigma; };
+			PointPos[i] = FVector4(ClusterCenter + FVector(Offset(), Offset(), Offset()), 1.0f);
+		}
+	}
+	else
+	{
+		for (int32 i = 0; i < NumElements; ++i)
+			PointPos[i] = FVector4(Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), Random.FRandRange(-Extent, Extent), 1.0f);
+	}
+
+	OutKeys.SetNumUninitialized(NumElements);
+	FComputeShaderCPUSort::GenerateSortKeys(PointPos.GetData(), NumElements, CamPos, OutKeys.GetData());
+
+	if (Input == EPointSortBenchmarkInput::Sorted || Input == EPointSortBenchmarkInput::PreviousFrame)
+	{
+		TArray<FSortKeyIndex> Scratch;
+		Scratch.SetNumUninitialized(NumElements);
+		FComputeShaderCPUSort::ParallelRadixSort(OutKeys.GetData(), Scratch.GetData(), NumElements);
+
+		//* Keys of a slightly moved camera, in the order of the last frame */
+		if (Input == EPointSortBenchmarkInput::PreviousFrame)
+		{
+			const FVector4 MovedCamPos = CamPos + FVector4(10.0f, 5.0f, 0.0f, 0.0f);
+			FComputeShaderCPUSort::GenerateSortKeys(PointPos.GetData(), NumElements, MovedCamPos, Scratch.GetData());
+			for (FSortKeyIndex& Pair : OutKeys)
+				Pair = Scratch[Pair.Index];
+		}
+	}
+}
+
+bool FPointSortBenchmark::IsSorted(const TArray<FSortKeyIndex>& Input, const TArray<FSortKeyIndex>& Sorted)
+{
+	const int32 Num = Input.Num();
+	if (Sorted.Num() != Num)
+		return false;
+
+	//* The indices of the input are a permutation of [0, Num) (see GenerateInput), remember the key of each one */
+	TArray<uint32> InputKeys;
+	InputKeys.SetNumUninitialized(Num);
+	for (const FSortKeyIndex& Pair : Input)
+		InputKeys[Pair.Index] = Pair.Key;
+
+	//* Descending keys, each pair of the input exactly once */
+	TBitArray<> Seen(false, Num);
+	for (int32 i = 0; i < Num; ++i)
+	{
+		const FSortKeyIndex& Pair = Sorted[i];
+		if (i > 0 && Sorted[i - 1].Key < Pair.Key)
+			return false;
+		if (Pair.Index >= (uint32)Num || Seen[Pair.Index] || InputKeys[Pair.Index] != Pair.Key)
+			return false;
+		Seen[Pair.Index] = true;
+	}
+	return true;
+}
+
+FString FPointSortBenchmark::GetCSVHeader()
+{
+	return TEXT("Backend,Input,NumElements,Passes,BytesMoved,PayloadBytesMoved,BestMs,MeanMs,MKeysPerSecond,Sorted");
+}
+
+FString FPointSortBenchmark::ToCSV(const FPointSortBenchmarkResult& Result)
+{
+	return FString::Printf(TEXT("%s,%s,%u,%u,%llu,%llu,%.3f,%.3f,%.2f,%d"),
+		*Result.Backend,
+		GetPointSortBenchmarkInputName(Result.Input),
+		Result.NumElements,
+		Result.NumPasses,
+		Result.BytesMoved,
+		Result.PayloadBytesMoved,
+		Result.BestMs,
+		Result.MeanMs,
+		Result.BestMs > 0.0 ? Result.NumElements / (Result.BestMs * 1000.0) : 0.0,
+		Result.bSorted ? 1 : 0);
+}
+
+bool FPointSortBenchmark::Run(const FPointSortBenchmarkSettings& Settings, TArray<FPointSortBenchmarkResult>& OutResults)
+{
+	// The bitonic network needs at least one full row
+	const int32 MinLog2 = FMath::Max<int32>(Settings.MinLog2, FMath::FloorLog2(BITONIC_BLOCK_SIZE));
+	const int32 MaxLog2 = FMath::Min<int32>(Settings.MaxLog2, FMath::FloorLog2(MAX_NUM_ELEMENTS));
+	const int32 NumIterations = FMath::Max(Settings.NumIterations, 1);
+
+	bool bAllSorted = true;
+	TArray<FSortKeyIndex> Input, Keys, Scratch;
+
+	UE_LOG(LogPointSortBenchmark, Display, TEXT("%s"), *GetCSVHeader());
+
+	for (int32 Log2 = MinLog2; Log2 <= MaxLog2; ++Log2)
+	{
+		const uint32 NumElements = 1u << Log2;
+		Scratch.SetNumUninitialized(NumElements);
+
+		for (int32 InputType = 0; InputType < (int32)EPointSortBenchmarkInput::Num; ++InputType)
+		{
+			GenerateInput((EPointSortBenchmarkInput)InputType, NumElements, Settings.Seed, Input);
+
+			for (const FPointSortBenchmarkBackend& Backend : BenchmarkBackends)
+			{
+				FPointSortBenchmarkResult Result;
+				Result.Backend = Backend.Name;
+				Result.Input = (EPointSortBenchmarkInput)InputType;
+				Result.NumElements = NumElements;
+				Result.BestMs = MAX_dbl;
+				Result.MeanMs = 0.0;
+				Result.bSorted = true;
+				Backend.GetCost(NumElements, Result);
+
+				for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+				{
+					Keys = Input;
+
+					const double StartTime = FPlatformTime::Seconds();
+					Backend.Sort(Keys, Scratch);
+					const double Milliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+					Result.BestMs = FMath::Min(Result.BestMs, Milliseconds);
+					Result.MeanMs += Milliseconds / NumIterations;
+					Result.bSorted &= IsSorted(Input, Keys);
+				}
+
+				if (!Result.bSorted)
+					UE_LOG(LogPointSortBenchmark, Error, TEXT("%s did not sort %u %s keys"), Backend.Name, NumElements, GetPointSortBenchmarkInputName(Result.Input));
+				UE_LOG(LogPointSortBenchmark, Display, TEXT("%s"), *ToCSV(Result));
+
+				bAllSorted &= Result.bSorted;
+				OutResults.Add(Result);
+			}
+		}
+	}
+	return bAllSorted;
+}
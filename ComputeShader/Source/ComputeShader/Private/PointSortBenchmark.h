@@ -0,0 +1,98 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ComputeShaderReference.h"
+
+// Results and errors of the benchmark runs (also of the PointSortBenchmark commandlet)
+DECLARE_LOG_CATEGORY_EXTERN(LogPointSortBenchmark, Log, All);
+
+/************************************************************************/
+/* Inputs the benchmark sorts, the keys are generated like on the GPU   */
+/************************************************************************/
+enum class EPointSortBenchmarkInput : uint8
+{
+	// Points spread uniformly over a cube
+	Uniform,
+	// Dense clusters of points, like the scan positions of a laser scan (many nearly equal keys)
+	Clustered,
+	// Keys that are already in the sorted order
+	Sorted,
+	// The order of the last frame after a small camera move (the incremental sort case)
+	PreviousFrame,
+	Num
+};
+
+const TCHAR* GetPointSortBenchmarkInputName(EPointSortBenchmarkInput Input);
+
+/** Settings of a benchmark run: problem sizes 2^MinLog2 ... 2^MaxLog2 */
+struct FPointSortBenchmarkSettings
+{
+	int32 MinLog2 = 10;
+	int32 MaxLog2 = 24;
+	int32 NumIterations = 3;
+	int32 Seed = 0x5EED;
+};
+
+/** One row of the results */
+struct FPointSortBenchmarkResult
+{
+	FString Backend;
+	EPointSortBenchmarkInput Input;
+	uint32 NumElements;
+	// Dispatches on the GPU (passes over the data on the CPU)
+	uint32 NumPasses;
+	// Device memory read and written for key/index pairs (worst case), and for the payload bitonic sort (bitonic backends only)
+	uint64 BytesMoved;
+	uint64 PayloadBytesMoved;
+	double BestMs;
+	double MeanMs;
+	// Descending keys and a permutation of the input pairs, after every iteration
+	bool bSorted;
+};
+
+/***************************************************************************/
+/* Sorts key/index pairs with the C++ ports of the sorting kernels (the    */
+/* dispatch schedules of ParallelBitonicSort/ParallelBitonicSortKeys and   */
+/* the radix sort passes) and with the CPU strategy, and checks the        */
+/* results. Needs no GPU, see UPointSortBenchmarkCommandlet for CI runs.   */
+/***************************************************************************/
+struct COMPUTESHADER_API FPointSortBenchmark
+{
+	// Runs all backends on all inputs and sizes, returns false if any result is not sorted
+	static bool Run(const FPointSortBenchmarkSettings& Settings, TArray<FPointSortBenchmarkResult>& OutResults);
+
+	static FString GetCSVHeader();
+	static FString ToCSV(const FPointSortBenchmarkResult& Result);
+
+	// Sorted holds the pairs of Input in descending key order (the order of equal keys doesn't matter). The indices of Input are a permutation of [0, Num).
+	static bool IsSorted(const TArray<FSortKeyIndex>& Input, const TArray<FSortKeyIndex>& Sorted);
+
+	// Key/index pairs of NumElements points for the given input
+	static void GenerateInput(EPointSortBenchmarkInput Input, int32 NumElements, int32 Seed, TArray<FSortKeyIndex>& OutKeys);
+};
@@ -0,0 +1,63 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+#include "ComputeShaderPrivatePCH.h"
+#include "PointSortBenchmarkCommandlet.h"
+#include "PointSortBenchmark.h"
+#include "Misc/FileHelper.h"
+
+UPointSortBenchmarkCommandlet::UPointSortBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UPointSortBenchmarkCommandlet::Main(const FString& Params)
+{
+	FPointSortBenchmarkSettings Settings;
+	FParse::Value(*Params, TEXT("MinLog2="), Settings.MinLog2);
+	FParse::Value(*Params, TEXT("MaxLog2="), Settings.MaxLog2);
+	FParse::Value(*Params, TEXT("Iterations="), Settings.NumIterations);
+	FParse::Value(*Params, TEXT("Seed="), Settings.Seed);
+
+	FString OutputFile = FPaths::ProjectSavedDir() / TEXT("Profiling/PointSortBenchmark.csv");
+	FParse::Value(*Params, TEXT("Output="), OutputFile);
+
+	TArray<FPointSortBenchmarkResult> Results;
+	const bool bAllSorted = FPointSortBenchmark::Run(Settings, Results);
+
+	FString CSV = FPointSortBenchmark::GetCSVHeader() + LINE_TERMINATOR;
+	for (const FPointSortBenchmarkResult& Result : Results)
+		CSV += FPointSortBenchmark::ToCSV(Result) + LINE_TERMINATOR;
+
+	if (!FFileHelper::SaveStringToFile(CSV, *OutputFile)) {
+		UE_LOG(LogPointSortBenchmark, Error, TEXT("Failed to write the benchmark results to \"%s\""), *OutputFile);
+		return 1;
+	}
+	UE_LOG(LogPointSortBenchmark, Display, TEXT("Benchmark results were saved to \"%s\""), *OutputFile);
+
+	return bAllSorted ? 0 : 1;
+}
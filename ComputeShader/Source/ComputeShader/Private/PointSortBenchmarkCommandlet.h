@@ -0,0 +1,50 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "PointSortBenchmarkCommandlet.generated.h"
+
+/************************************************************************/
+/* Runs FPointSortBenchmark without a GPU and writes the results as CSV */
+/* UE4Editor-Cmd <Project> -run=PointSortBenchmark -nullrhi             */
+/*     [-MinLog2=10] [-MaxLog2=24] [-Iterations=3] [-Seed=n]            */
+/*     [-Output=<file>]                                                 */
+/* The default output is Saved/Profiling/PointSortBenchmark.csv.        */
+/* Returns 1 if any backend didn't sort, so CI jobs fail on it.         */
+/************************************************************************/
+UCLASS()
+class UPointSortBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPointSortBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
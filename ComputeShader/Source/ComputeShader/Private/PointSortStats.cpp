@@ -0,0 +1,295 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+#include "ComputeShaderPrivatePCH.h"
+#include "PointSortStats.h"
+
+DEFINE_STAT(STAT_PointSort_Execute);
+DEFINE_STAT(STAT_PointSort_Upload);
+DEFINE_STAT(STAT_PointSort_DispatchSort);
+DEFINE_STAT(STAT_PointSort_ParallelBitonicSort);
+DEFINE_STAT(STAT_PointSort_CPU);
+DEFINE_STAT(STAT_PointSort_GPU_Upload);
+DEFINE_STAT(STAT_PointSort_GPU_Keys);
+DEFINE_STAT(STAT_PointSort_GPU_LocalSort);
+DEFINE_STAT(STAT_PointSort_GPU_GlobalSort);
+DEFINE_STAT(STAT_PointSort_GPU_Output);
+DEFINE_STAT(STAT_PointSort_GPU_Total);
+
+const TCHAR* GetPointSortPhaseName(EPointSortPhase Phase)
+{
+	switch (Phase)
+	{
+	case EPointSortPhase::Upload:		return TEXT("Upload");
+	case EPointSortPhase::Keys:			return TEXT("Keys");
+	case EPointSortPhase::LocalSort:	return TEXT("LocalSort");
+	case EPointSortPhase::GlobalSort:	return TEXT("GlobalSort");
+	case EPointSortPhase::Output:		return TEXT("Output");
+	case EPointSortPhase::Total:		return TEXT("Total");
+	default:							return TEXT("Unknown");
+	}
+}
+
+static void SetPointSortGPUStat(EPointSortPhase Phase, float Milliseconds)
+{
+	switch (Phase)
+	{
+	case EPointSortPhase::Upload:		SET_FLOAT_STAT(STAT_PointSort_GPU_Upload, Milliseconds); break;
+	case EPointSortPhase::Keys:			SET_FLOAT_STAT(STAT_PointSort_GPU_Keys, Milliseconds); break;
+	case EPointSortPhase::LocalSort:	SET_FLOAT_STAT(STAT_PointSort_GPU_LocalSort, Milliseconds); break;
+	case EPointSortPhase::GlobalSort:	SET_FLOAT_STAT(STAT_PointSort_GPU_GlobalSort, Milliseconds); break;
+	case EPointSortPhase::Output:		SET_FLOAT_STAT(STAT_PointSort_GPU_Output, Milliseconds); break;
+	case EPointSortPhase::Total:		SET_FLOAT_STAT(STAT_PointSort_GPU_Total, Milliseconds); break;
+	default:							break;
+	}
+}
+
+FPointSortTimings& FPointSortTimings::Get()
+{
+	static FPointSortTimings Timings;
+	return Timings;
+}
+
+void FPointSortTimings::FSampleWindow::Add(float Milliseconds)
+{
+	Samples[NextSample] = Milliseconds;
+	NextSample = (NextSample + 1) % POINT_SORT_TIMING_WINDOW;
+	NumSamples = FMath::Min(NumSamples + 1, POINT_SORT_TIMING_WINDOW);
+}
+
+FPointSortTimingSummary FPointSortTimings::FSampleWindow::Summarize() const
+{
+	FPointSortTimingSummary Summary;
+	if (NumSamples == 0)
+		return Summary;
+
+	// The window is small, sorting a copy is cheap enough for a query
+	TArray<float, TInlineAllocator<POINT_SORT_TIMING_WINDOW>> Sorted;
+	Sorted.Append(Samples, NumSamples);
+	Sorted.Sort();
+
+	float Sum = 0.0f;
+	for (float Sample : Sorted)
+		Sum += Sample;
+
+	// Nearest rank percentiles
+	auto Percentile = [&Sorted](float P) { return Sorted[FMath::Clamp(FMath::CeilToInt(P * Sorted.Num()) - 1, 0, Sorted.Num() - 1)]; };
+
+	Summary.NumSamples = NumSamples;
+	Summary.AverageMs = Sum / NumSamples;
+	Summary.P95Ms = Percentile(0.95f);
+	Summary.P99Ms = Percentile(0.99f);
+	Summary.MaxMs = Sorted.Last();
+	return Summary;
+}
+
+void FPointSortTimings::AddGPUSample(EPointSortPhase Phase, float Milliseconds)
+{
+	check(Phase < EPointSortPhase::Num);
+	FScopeLock ScopeLock(&Lock);
+	GPUSamples[(int32)Phase].Add(Milliseconds);
+}
+
+void FPointSortTimings::AddRenderThreadSample(float Milliseconds)
+{
+	FScopeLock ScopeLock(&Lock);
+	RenderThreadSamples.Add(Milliseconds);
+}
+
+void FPointSortTimings::AddUnmeasuredGPUSort()
+{
+	FScopeLock ScopeLock(&Lock);
+	++NumUnmeasuredGPUSorts;
+}
+
+FPointSortTimingSummary FPointSortTimings::GetGPUTiming(EPointSortPhase Phase) const
+{
+	check(Phase < EPointSortPhase::Num);
+	FScopeLock ScopeLock(&Lock);
+	FPointSortTimingSummary Summary = GPUSamples[(int32)Phase].Summarize();
+	Summary.NumUnmeasured = NumUnmeasuredGPUSorts;
+	return Summary;
+}
+
+FPointSortTimingSummary FPointSortTimings::GetRenderThreadTiming() const
+{
+	FScopeLock ScopeLock(&Lock);
+	return RenderThreadSamples.Summarize();
+}
+
+void FPointSortTimings::Reset()
+{
+	FScopeLock ScopeLock(&Lock);
+	for (FSampleWindow& Window : GPUSamples)
+		Window = FSampleWindow();
+	RenderThreadSamples = FSampleWindow();
+	NumUnmeasuredGPUSorts = 0;
+}
+
+void FPointSortTimings::LogTimings(float BudgetMs) const
+{
+	auto LogRow = [BudgetMs](const TCHAR* Name, const FPointSortTimingSummary& Summary)
+	{
+		if (Summary.NumSamples == 0 && Summary.NumUnmeasured > 0) {
+			UE_LOG(LogConsoleResponse, Display, TEXT("%-14s not measured"), Name);
+			return;
+		}
+		UE_LOG(LogConsoleResponse, Display, TEXT("%-14s %8d %9.3f %9.3f %9.3f %9.3f %9.1f"),
+			Name, Summary.NumSamples, Summary.AverageMs, Summary.P95Ms, Summary.P99Ms, Summary.MaxMs,
+			BudgetMs > 0.0f ? 100.0f * Summary.P99Ms / BudgetMs : 0.0f);
+	};
+
+	UE_LOG(LogConsoleResponse, Display, TEXT("Point sort timings over the last %d sorts, budget %.1f ms"), POINT_SORT_TIMING_WINDOW, BudgetMs);
+	UE_LOG(LogConsoleResponse, Display, TEXT("%-14s %8s %9s %9s %9s %9s %9s"), TEXT("Timing"), TEXT("Samples"), TEXT("Avg ms"), TEXT("P95 ms"), TEXT("P99 ms"), TEXT("Max ms"), TEXT("P99 %"));
+
+	for (int32 Phase = 0; Phase < (int32)EPointSortPhase::Num; ++Phase)
+		LogRow(*FString::Printf(TEXT("GPU %s"), GetPointSortPhaseName((EPointSortPhase)Phase)), GetGPUTiming((EPointSortPhase)Phase));
+	LogRow(TEXT("RenderThread"), GetRenderThreadTiming());
+
+	// The timestamps can't be written on the async compute pipe
+	const int32 NumUnmeasured = GetGPUTiming(EPointSortPhase::Total).NumUnmeasured;
+	if (NumUnmeasured > 0)
+		UE_LOG(LogConsoleResponse, Display, TEXT("%d sorts on the async compute pipe have no GPU timings, disable async compute (SetAsyncCompute) to measure them"), NumUnmeasured);
+}
+
+static void PointSortTimingsCommand(const TArray<FString>& Args)
+{
+	if (Args.Num() > 0 && Args[0] == TEXT("reset")) {
+		FPointSortTimings::Get().Reset();
+		return;
+	}
+	FPointSortTimings::Get().LogTimings(Args.Num() > 0 ? FCString::Atof(*Args[0]) : POINT_SORT_FRAME_BUDGET_MS);
+}
+
+static FAutoConsoleCommand PointSortTimingsConsoleCommand(
+	TEXT("ComputeShader.SortTimings"),
+	TEXT("Logs the rolling average, p95 and p99 of the sort phases on the GPU and of the render thread. Arguments: reset, or the frame budget in ms (default 11.1)"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&PointSortTimingsCommand));
+
+void FPointSortGPUTimer::BeginFrame(FRHICommandListImmediate& RHICmdList)
+{
+	RecordingFrame = nullptr;
+	if (!GSupportsTimestampRenderQueries)
+		return;
+
+	//* Collect the executions the GPU is done with, oldest first */
+	for (int32 i = 0; i < POINT_SORT_TIMER_FRAMES; ++i)
+	{
+		FFrameQueries& Frame = Frames[(NextFrame + i) % POINT_SORT_TIMER_FRAMES];
+		if (Frame.bPending && ReadFrame(Frame))
+			Frame.bPending = false;
+	}
+
+	//* Reuse the oldest queries, if the GPU hasn't reached them yet, their execution is not measured */
+	FFrameQueries& Frame = Frames[NextFrame];
+	NextFrame = (NextFrame + 1) % POINT_SORT_TIMER_FRAMES;
+
+	if (!Frame.Timestamps[0]) {
+		for (FRenderQueryRHIRef& Timestamp : Frame.Timestamps)
+			Timestamp = RHICreateRenderQuery(RQT_AbsoluteTime);
+	}
+	Frame.bPending = false;
+	Frame.MarkedPhases = 0;
+
+	RHICmdList.EndRenderQuery(Frame.Timestamps[0]);
+	RecordingFrame = &Frame;
+}
+
+void FPointSortGPUTimer::MarkPhaseEnd(FRHICommandList& RHICmdList, EPointSortPhase Phase)
+{
+	if (!RecordingFrame)
+		return;
+
+	RHICmdList.EndRenderQuery(RecordingFrame->Timestamps[(int32)Phase + 1]);
+	RecordingFrame->MarkedPhases |= 1 << (uint32)Phase;
+}
+
+void FPointSortGPUTimer::EndFrame(FRHICommandListImmediate& RHICmdList, bool bSorted)
+{
+	if (!RecordingFrame)
+		return;
+
+	if (bSorted)
+		MarkPhaseEnd(RHICmdList, EPointSortPhase::Total);
+
+	RecordingFrame->bPending = RecordingFrame->MarkedPhases != 0;
+	RecordingFrame = nullptr;
+}
+
+void FPointSortGPUTimer::DiscardFrame()
+{
+	if (!RecordingFrame)
+		return;
+
+	// The queries are reused by a later execution
+	RecordingFrame->MarkedPhases = 0;
+	RecordingFrame->bPending = false;
+	RecordingFrame = nullptr;
+}
+
+bool FPointSortGPUTimer::ReadFrame(FFrameQueries& Frame)
+{
+	//* Timestamps in microseconds, all of them have to be available */
+	uint64 Start;
+	uint64 PhaseEnd[(int32)EPointSortPhase::Num];
+	if (!RHIGetRenderQueryResult(Frame.Timestamps[0], Start, false))
+		return false;
+
+	for (int32 Phase = 0; Phase < (int32)EPointSortPhase::Num; ++Phase)
+	{
+		if ((Frame.MarkedPhases & (1 << Phase)) && !RHIGetRenderQueryResult(Frame.Timestamps[Phase + 1], PhaseEnd[Phase], false))
+			return false;
+	}
+
+	//* Each phase lasts from the end of the previous marked one (the total from the start) */
+	FPointSortTimings& Timings = FPointSortTimings::Get();
+	uint64 PhaseStart = Start;
+	for (int32 Phase = 0; Phase < (int32)EPointSortPhase::Num; ++Phase)
+	{
+		if (!(Frame.MarkedPhases & (1 << Phase)))
+			continue;
+
+		const bool bTotal = Phase == (int32)EPointSortPhase::Total;
+		const uint64 From = bTotal ? Start : PhaseStart;
+		const float Milliseconds = PhaseEnd[Phase] > From ? (PhaseEnd[Phase] - From) / 1000.0f : 0.0f;
+
+		Timings.AddGPUSample((EPointSortPhase)Phase, Milliseconds);
+		SetPointSortGPUStat((EPointSortPhase)Phase, Milliseconds);
+
+		if (!bTotal)
+			PhaseStart = PhaseEnd[Phase];
+	}
+	return true;
+}
+
+void FPointSortGPUTimer::Release()
+{
+	for (FFrameQueries& Frame : Frames)
+	{
+		for (FRenderQueryRHIRef& Timestamp : Frame.Timestamps)
+			Timestamp.SafeRelease();
+		Frame.bPending = false;
+	}
+	RecordingFrame = nullptr;
+}
@@ -0,0 +1,182 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHI.h"
+#include "RHICommandList.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("PointSort"), STATGROUP_PointSort, STATCAT_Advanced);
+
+// Render thread time of the sort (stat PointSort)
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Execute"), STAT_PointSort_Execute, STATGROUP_PointSort, COMPUTESHADER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Upload"), STAT_PointSort_Upload, STATGROUP_PointSort, COMPUTESHADER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Record sort"), STAT_PointSort_DispatchSort, STATGROUP_PointSort, COMPUTESHADER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ParallelBitonicSort"), STAT_PointSort_ParallelBitonicSort, STATGROUP_PointSort, COMPUTESHADER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("CPU sort"), STAT_PointSort_CPU, STATGROUP_PointSort, COMPUTESHADER_API);
+
+// GPU time of the phases, set when the timestamps of a sort have been read back (a few frames later)
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("GPU Upload (ms)"), STAT_PointSort_GPU_Upload, STATGROUP_PointSort, COMPUTESHADER_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("GPU Keys (ms)"), STAT_PointSort_GPU_Keys, STATGROUP_PointSort, COMPUTESHADER_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("GPU LocalSort (ms)"), STAT_PointSort_GPU_LocalSort, STATGROUP_PointSort, COMPUTESHADER_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("GPU GlobalSort (ms)"), STAT_PointSort_GPU_GlobalSort, STATGROUP_PointSort, COMPUTESHADER_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("GPU Output (ms)"), STAT_PointSort_GPU_Output, STATGROUP_PointSort, COMPUTESHADER_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("GPU Total (ms)"), STAT_PointSort_GPU_Total, STATGROUP_PointSort, COMPUTESHADER_API);
+
+// Number of sorts the rolling averages and percentiles are taken over
+const int32 POINT_SORT_TIMING_WINDOW = 256;
+
+// Executions whose timestamps can be in flight at once, older ones are dropped if the GPU is further behind
+const int32 POINT_SORT_TIMER_FRAMES = 4;
+
+// Frame budget the console command relates the timings to (90 Hz VR)
+const float POINT_SORT_FRAME_BUDGET_MS = 11.1f;
+
+/************************************************************************/
+/* Phases of a sort, in the order they are recorded                     */
+/************************************************************************/
+enum class EPointSortPhase : uint8
+{
+	// Point data uploads (UpdateDataBuffers). The buffers are written through locks on the CPU, only the copies the RHI schedules on the GPU are measured
+	Upload,
+	// Key generation, including the culling
+	Keys,
+	// The in-block levels: the local sort pass, or the fix-up passes of an incremental sort
+	LocalSort,
+	// The levels beyond the block (transposes, global merges and row sorts), or the radix passes
+	GlobalSort,
+	// Gather into the output textures (key sorts) or the texture upload (CPU strategy), the payload sort writes them in its last pass
+	Output,
+	// From the upload to the end of the sort
+	Total,
+	Num
+};
+
+const TCHAR* GetPointSortPhaseName(EPointSortPhase Phase);
+
+/** Rolling statistics of one timing in milliseconds */
+struct FPointSortTimingSummary
+{
+	int32 NumSamples = 0;
+	float AverageMs = 0.0f;
+	float P95Ms = 0.0f;
+	float P99Ms = 0.0f;
+	float MaxMs = 0.0f;
+	// Sorts since the last reset that have no GPU timestamps (async compute), not part of the statistics above
+	int32 NumUnmeasured = 0;
+};
+
+/************************************************************************/
+/* Aggregates the timings of all sorts (of all FComputeShader           */
+/* instances) over the last POINT_SORT_TIMING_WINDOW samples. Written   */
+/* on the render thread, can be queried from any thread.                */
+/* Console: ComputeShader.SortTimings [reset | <budget in ms>]          */
+/************************************************************************/
+class COMPUTESHADER_API FPointSortTimings
+{
+public:
+	static FPointSortTimings& Get();
+
+	void AddGPUSample(EPointSortPhase Phase, float Milliseconds);
+	void AddRenderThreadSample(float Milliseconds);
+	void AddUnmeasuredGPUSort();
+
+	// GPU time of a phase. Only the sorts on the graphics pipe are measured (see FPointSortGPUTimer), the others are counted in NumUnmeasured.
+	FPointSortTimingSummary GetGPUTiming(EPointSortPhase Phase) const;
+	// Render thread time of ExecuteComputeShaderInternal, including the CPU strategy
+	FPointSortTimingSummary GetRenderThreadTiming() const;
+
+	void Reset();
+	void LogTimings(float BudgetMs = POINT_SORT_FRAME_BUDGET_MS) const;
+
+private:
+	/** Ring of the newest samples */
+	struct FSampleWindow
+	{
+		float Samples[POINT_SORT_TIMING_WINDOW];
+		int32 NumSamples = 0;
+		int32 NextSample = 0;
+
+		void Add(float Milliseconds);
+		FPointSortTimingSummary Summarize() const;
+	};
+
+	FSampleWindow GPUSamples[(int32)EPointSortPhase::Num];
+	FSampleWindow RenderThreadSamples;
+	int32 NumUnmeasuredGPUSorts = 0;
+	mutable FCriticalSection Lock;
+};
+
+/************************************************************************/
+/* GPU timestamps around the phases of the sorts of one FComputeShader  */
+/* (render thread only). The results are read back without waiting once */
+/* the GPU has passed them and added to FPointSortTimings. The async    */
+/* compute list cannot write timestamps in this RHI, so the executions  */
+/* that sort there are discarded and only counted as not measured.      */
+/************************************************************************/
+class FPointSortGPUTimer
+{
+public:
+	// Starts an execution, collects the results of the previous ones
+	void BeginFrame(FRHICommandListImmediate& RHICmdList);
+
+	// Ends the phase that has been recorded since the last mark (phases have to be marked in order)
+	void MarkPhaseEnd(FRHICommandList& RHICmdList, EPointSortPhase Phase);
+	// The async compute list can't write timestamps, see DiscardFrame
+	void MarkPhaseEnd(FRHIAsyncComputeCommandListImmediate& RHICmdList, EPointSortPhase Phase) {}
+
+	// Ends the execution, bSorted = false leaves out the total (nothing has been sorted)
+	void EndFrame(FRHICommandListImmediate& RHICmdList, bool bSorted);
+
+	// Ends the execution without results, its sort ran where it could not be measured
+	void DiscardFrame();
+
+	// Ignores the marks in between, for work that runs the sort phases once more (only counted in the total)
+	void SuspendMarks() { SuspendedFrame = RecordingFrame; RecordingFrame = nullptr; }
+	void ResumeMarks() { RecordingFrame = SuspendedFrame; SuspendedFrame = nullptr; }
+
+	void Release();
+
+private:
+	/** The timestamps of one execution: its start and the end of each phase */
+	struct FFrameQueries
+	{
+		FRenderQueryRHIRef Timestamps[(int32)EPointSortPhase::Num + 1];
+		uint32 MarkedPhases = 0;
+		bool bPending = false;
+	};
+
+	bool ReadFrame(FFrameQueries& Frame);
+
+	FFrameQueries Frames[POINT_SORT_TIMER_FRAMES];
+	int32 NextFrame = 0;
+
+	/** The execution between BeginFrame and EndFrame, null if timestamps are not supported */
+	FFrameQueries* RecordingFrame = nullptr;
+	FFrameQueries* SuspendedFrame = nullptr;
+};
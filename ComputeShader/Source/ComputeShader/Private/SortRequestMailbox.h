@@ -0,0 +1,156 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ComputeShaderDeclaration.h"
+
+/** Everything a sort request carries from the game thread to the render thread */
+struct FSortRequest
+{
+	FVector4 CamPos;
+	/** Normalized, zero if the request has none (only used by the view depth keys) */
+	FVector4 ViewDir = FVector4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	/** Camera of each point cloud of a batch (see FComputeShaderBatch), 0 for a single point cloud */
+	int32 NumSegments = 0;
+	FVector4 SegmentCamPos[MAX_SORT_SEGMENTS];
+	FVector4 SegmentViewDir[MAX_SORT_SEGMENTS];
+
+	/** Frustum culling ahead of the sort (see FComputeShader::ExecuteComputeShader) */
+	bool bCull = false;
+	FMatrix CullViewProjection = FMatrix::Identity;
+
+	/** Copies only the used part of the segment cameras */
+	void CopyFrom(const FSortRequest& Other)
+	{
+		CamPos = Other.CamPos;
+		ViewDir = Other.ViewDir;
+		bCull = Other.bCull;
+		CullViewProjection = Other.CullViewProjection;
+		// Clamped, the reader of the mailbox may see a torn request (and discards it)
+		NumSegments = FMath::Clamp<int32>(Other.NumSegments, 0, MAX_SORT_SEGMENTS);
+		FMemory::Memcpy(SegmentCamPos, Other.SegmentCamPos, sizeof(FVector4) * NumSegments);
+		FMemory::Memcpy(SegmentViewDir, Other.SegmentViewDir, sizeof(FVector4) * NumSegments);
+	}
+
+	/**
+	 * The largest distance a camera moved between both requests, a changed culling frustum counts as a jump.
+	 * @param bCompareViewDirs - The keys depend on the view directions (view depth keys), a turned camera counts as a jump
+	 */
+	float GetMaxCameraDelta(const FSortRequest& Other, bool bCompareViewDirs) const
+	{
+		if (NumSegments != Other.NumSegments || bCull != Other.bCull)
+			return MAX_flt;
+		if (bCull && !CullViewProjection.Equals(Other.CullViewProjection, 0.0f))
+			return MAX_flt;
+		if (bCompareViewDirs && !HasSameViewDirs(Other))
+			return MAX_flt;
+
+		float Delta = FVector(CamPos - Other.CamPos).Size();
+		for (int32 i = 0; i < NumSegments; ++i)
+			Delta = FMath::Max(Delta, FVector(SegmentCamPos[i] - Other.SegmentCamPos[i]).Size());
+		return Delta;
+	}
+
+	bool HasSameViewDirs(const FSortRequest& Other) const
+	{
+		if (ViewDir != Other.ViewDir)
+			return false;
+		for (int32 i = 0; i < NumSegments && i < Other.NumSegments; ++i) {
+			if (SegmentViewDir[i] != Other.SegmentViewDir[i])
+				return false;
+		}
+		return true;
+	}
+};
+
+/***************************************************************************/
+/* Lock-free single-slot mailbox between the game thread (the only        */
+/* writer) and the render thread: the latest request wins. Publishing     */
+/* never blocks, the slot is guarded by a sequence number that is odd     */
+/* while the writer is busy (seqlock). Requests that arrive before the    */
+/* render thread gets to them are merged into the newest one.             */
+/***************************************************************************/
+class FSortRequestMailbox
+{
+public:
+	/**
+	 * Stores the request in the slot (game thread).
+	 * @return true if the render thread has to be notified, i.e. no notification is outstanding yet
+	 */
+	bool Publish(const FSortRequest& Request)
+	{
+		FPlatformAtomics::InterlockedIncrement(&Sequence);
+		FPlatformMisc::MemoryBarrier();
+		Slot.CopyFrom(Request);
+		FPlatformMisc::MemoryBarrier();
+		FPlatformAtomics::InterlockedIncrement(&Sequence);
+
+		return FPlatformAtomics::InterlockedExchange(&bNotificationPending, 1) == 0;
+	}
+
+	/**
+	 * Takes the newest request (render thread).
+	 * @return false if there is no request that has not been consumed yet
+	 */
+	bool Consume(FSortRequest& OutRequest)
+	{
+		// Publishing from now on notifies again, so no request can get lost
+		FPlatformAtomics::InterlockedExchange(&bNotificationPending, 0);
+
+		int32 Begin, End;
+		do
+		{
+			Begin = FPlatformAtomics::AtomicRead(&Sequence);
+			if (Begin & 1) {
+				FPlatformProcess::Yield();
+				continue;
+			}
+			FPlatformMisc::MemoryBarrier();
+			OutRequest.CopyFrom(Slot);
+			FPlatformMisc::MemoryBarrier();
+			End = FPlatformAtomics::AtomicRead(&Sequence);
+		} while ((Begin & 1) || Begin != End);
+
+		if (Begin == ConsumedSequence)
+			return false;
+
+		ConsumedSequence = Begin;
+		return true;
+	}
+
+private:
+	FSortRequest Slot;
+
+	/** Incremented before and after each write of the slot */
+	volatile int32 Sequence = 0;
+	/** Set while a render command that will consume the slot is enqueued */
+	volatile int32 bNotificationPending = 0;
+	/** The sequence number of the last consumed request (render thread only) */
+	int32 ConsumedSequence = 0;
+};
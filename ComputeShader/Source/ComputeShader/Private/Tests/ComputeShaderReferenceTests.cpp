@@ -0,0 +1,174 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+#include "ComputeShaderPrivatePCH.h"
+#include "ComputeShaderReference.h"
+#include "Misc/AutomationTest.h"
+#include "Algo/StableSort.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/************************************************************************/
+/* Headless checks of the C++ reference kernels (no GPU needed):        */
+/* Automation RunTests ComputeShader.Reference                          */
+/************************************************************************/
+
+// Inputs of the checks, the indices are the positions in the input
+enum class EReferenceTestInput : uint8
+{
+	Random,
+	// Already in the order of the sort (descending keys)
+	Sorted,
+	// Ascending keys
+	Reverse,
+	Num
+};
+
+static const TCHAR* GetReferenceTestInputName(EReferenceTestInput Input)
+{
+	switch (Input)
+	{
+	case EReferenceTestInput::Random:	return TEXT("Random");
+	case EReferenceTestInput::Sorted:	return TEXT("Sorted");
+	case EReferenceTestInput::Reverse:	return TEXT("Reverse");
+	default:							return TEXT("Unknown");
+	}
+}
+
+static void GenerateReferenceTestInput(EReferenceTestInput Input, uint32 NumKeys, uint32 KeyRange, int32 Seed, TArray<FSortKeyIndex>& OutKeys)
+{
+	FRandomStream Random(Seed);
+	OutKeys.SetNumUninitialized(NumKeys);
+	for (uint32 i = 0; i < NumKeys; ++i)
+	{
+		OutKeys[i].Key = KeyRange > 0 ? Random.GetUnsignedInt() % KeyRange : Random.GetUnsignedInt();
+		OutKeys[i].Index = i;
+	}
+
+	if (Input == EReferenceTestInput::Sorted)
+		OutKeys.Sort([](const FSortKeyIndex& A, const FSortKeyIndex& B) { return A.Key > B.Key; });
+	else if (Input == EReferenceTestInput::Reverse)
+		OutKeys.Sort([](const FSortKeyIndex& A, const FSortKeyIndex& B) { return A.Key < B.Key; });
+}
+
+// Index of the first pair that differs, INDEX_NONE if both hold the same pairs in the same order
+static int32 FindFirstMismatch(const TArray<FSortKeyIndex>& A, const TArray<FSortKeyIndex>& B)
+{
+	if (A.Num() != B.Num())
+		return 0;
+
+	for (int32 i = 0; i < A.Num(); ++i)
+	{
+		if (A[i].Key != B[i].Key || A[i].Index != B[i].Index)
+			return i;
+	}
+	return INDEX_NONE;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FComputeShaderReferenceBitonicWaveOpsTest, "ComputeShader.Reference.BitonicWaveOps", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FComputeShaderReferenceBitonicWaveOpsTest::RunTest(const FString& Parameters)
+{
+	//* The lane exchanges of SORT_WAVE_OPS have to give the same network as the steps on the shared memory, bit for bit */
+	const uint32 NumKeysToTest[] = { BITONIC_BLOCK_SIZE, BITONIC_BLOCK_SIZE * 16 };
+	const uint32 WaveSizes[] = { 32, 64 };
+	const EBitonicScheduleType ScheduleTypes[] = { EBitonicScheduleType::Transpose, EBitonicScheduleType::GlobalMerge };
+
+	TArray<FSortKeyIndex> Input, Expected, Keys;
+	for (uint32 NumKeys : NumKeysToTest)
+	{
+		for (int32 InputType = 0; InputType < (int32)EReferenceTestInput::Num; ++InputType)
+		{
+			// Few distinct keys, so that the order of equal keys is compared as well
+			GenerateReferenceTestInput((EReferenceTestInput)InputType, NumKeys, NumKeys / 4, 0x5EED + InputType, Input);
+
+			for (EBitonicScheduleType ScheduleType : ScheduleTypes)
+			{
+				Expected = Input;
+				FComputeShaderReference::BitonicSort(Expected, ScheduleType, 0);
+
+				for (uint32 i = 1; i < NumKeys; ++i)
+				{
+					if (Expected[i - 1].Key < Expected[i].Key) {
+						AddError(FString::Printf(TEXT("The shared memory network did not sort %u %s keys (pair %u)"), NumKeys, GetReferenceTestInputName((EReferenceTestInput)InputType), i));
+						break;
+					}
+				}
+
+				for (uint32 WaveSize : WaveSizes)
+				{
+					Keys = Input;
+					FComputeShaderReference::BitonicSort(Keys, ScheduleType, WaveSize);
+
+					const int32 Mismatch = FindFirstMismatch(Expected, Keys);
+					if (Mismatch != INDEX_NONE)
+					{
+						AddError(FString::Printf(TEXT("Wave size %u differs from the shared memory network at pair %d (%s schedule, %u %s keys)"),
+							WaveSize, Mismatch, ScheduleType == EBitonicScheduleType::Transpose ? TEXT("transpose") : TEXT("global merge"), NumKeys, GetReferenceTestInputName((EReferenceTestInput)InputType)));
+					}
+				}
+			}
+		}
+	}
+	return !HasAnyErrors();
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FComputeShaderReferenceRadixSortTest, "ComputeShader.Reference.RadixSortStable", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FComputeShaderReferenceRadixSortTest::RunTest(const FString& Parameters)
+{
+	//* Several groups cover the digit-major counters and the prefix scan across the groups */
+	const uint32 NumKeysToTest[] = { RADIX_BLOCK_SIZE, RADIX_BLOCK_SIZE * 5 };
+	// Full range keys reach every digit of every pass, few distinct keys test the order of equal keys
+	const uint32 KeyRanges[] = { 0, 64 };
+
+	TArray<FSortKeyIndex> Input, Expected, Keys;
+	for (uint32 NumKeys : NumKeysToTest)
+	{
+		for (int32 InputType = 0; InputType < (int32)EReferenceTestInput::Num; ++InputType)
+		{
+			for (uint32 KeyRange : KeyRanges)
+			{
+				GenerateReferenceTestInput((EReferenceTestInput)InputType, NumKeys, KeyRange, 0xD1617 + InputType, Input);
+
+				// The radix sort orders by the inverted keys (descending keys) and keeps the input order of equal keys
+				Expected = Input;
+				Algo::StableSort(Expected, [](const FSortKeyIndex& A, const FSortKeyIndex& B) { return ~A.Key < ~B.Key; });
+
+				Keys = Input;
+				FComputeShaderReference::RadixSort(Keys);
+
+				const int32 Mismatch = FindFirstMismatch(Expected, Keys);
+				if (Mismatch != INDEX_NONE)
+				{
+					AddError(FString::Printf(TEXT("The radix sort differs from a stable sort at pair %d (%u %s keys, key range %u)"),
+						Mismatch, NumKeys, GetReferenceTestInputName((EReferenceTestInput)InputType), KeyRange));
+				}
+			}
+		}
+	}
+	return !HasAnyErrors();
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
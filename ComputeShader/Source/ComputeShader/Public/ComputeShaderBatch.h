@@ -0,0 +1,86 @@
+/******************************************************************************
+* The MIT License (MIT)
+*
+* Copyright (c) 2015 Fredrik Lindh
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+******************************************************************************/
+
+
+
+#pragma once
+
+#include "ComputeShaderUsageExample.h"
+
+/************************************************************************/
+/* Where the sorted points of one point cloud of a batch are            */
+/************************************************************************/
+struct FPointCloudSortView
+{
+	/** The output textures shared by all point clouds of the batch */
+	FTexture2DRHIRef PointPosTexture;
+	FTexture2DRHIRef PointColorsTexture;
+	/** Point i of the cloud is at texel ((FirstElement + i) / TextureHeight, (FirstElement + i) % TextureHeight) */
+	int32 FirstElement;
+	int32 NumElements;
+	int32 TextureHeight;
+};
+
+/***************************************************************************/
+/* Sorts many point clouds at once: the clouds are packed into the shared */
+/* buffers of a single FComputeShader as segments, and one dispatch       */
+/* sequence sorts all of them, each for its own camera (segmented keys,   */
+/* see KeyIndexSortComputeShader.usf). Up to MAX_SORT_SEGMENTS clouds.    */
+/***************************************************************************/
+class COMPUTESHADER_API FComputeShaderBatch
+{
+public:
+	FComputeShaderBatch(ERHIFeatureLevel::Type ShaderFeatureLevel);
+	~FComputeShaderBatch();
+
+	/************************************************************************/
+	/* Adds a point cloud and returns its index. Grows the shared buffers   */
+	/* (flushes the rendering commands), so add all clouds up front.        */
+	/************************************************************************/
+	int32 AddCloud(int32 NumPoints);
+	int32 GetNumClouds() const { return Segments.Num(); }
+
+	// Replaces the points of a cloud (GPU layout, see FComputeShader::UpdatePointRange), only this range is uploaded
+	void SetCloudPointData(int32 CloudIndex, const FVector4* PointPos, const FVector4* PointColors);
+
+	// The camera position in the object space of the cloud, the view direction is only used by the view depth keys (see FComputeShader::SetSortKey)
+	void SetCloudCamera(int32 CloudIndex, const FVector4& CamPos, const FVector& ViewDirection = FVector::ZeroVector);
+
+	// Sorts all clouds for their current cameras
+	void Execute();
+
+	FPointCloudSortView GetCloudView(int32 CloudIndex);
+
+	// The shared sorter, e.g. to choose the sort strategy (key/index sorts only)
+	FComputeShader* GetComputeShader() { return ComputeShader.Get(); }
+
+private:
+	ERHIFeatureLevel::Type FeatureLevel;
+	TUniquePtr<FComputeShader> ComputeShader;
+
+	/** Layout of the clouds in the shared buffers and their cameras */
+	TArray<FPointSegment> Segments;
+	TArray<FVector4> CloudCamPos;
+	TArray<FVector4> CloudViewDir;
+};
@@ -25,12 +25,100 @@
 #pragma once
 
 #include "Private/ComputeShaderDeclaration.h"
+#include "Private/ComputeShaderCPUSort.h"
+#include "Private/SortRequestMailbox.h"
+#include "Private/PointSortStats.h"
 
-const UINT NUM_ELEMENTS = 1024 * 1024;
-const UINT BITONIC_BLOCK_SIZE = 1024;
-const UINT TRANSPOSE_BLOCK_SIZE = 16;
-const UINT MATRIX_WIDTH = BITONIC_BLOCK_SIZE;
-const UINT MATRIX_HEIGHT = NUM_ELEMENTS / BITONIC_BLOCK_SIZE;
+class UTextureRenderTarget2D;
+
+/************************************************************************/
+/* How the points are moved through the sorting network                 */
+/************************************************************************/
+enum class ESortMode : uint8
+{
+	// The full point positions and colors are sorted (in place in the data buffers)
+	Payload,
+	// Only (distance key, point index) pairs are sorted, the points are gathered from the unsorted data once at the end
+	KeyIndex
+};
+
+/************************************************************************/
+/* The algorithm that sorts the points                                  */
+/************************************************************************/
+enum class ESortStrategy : uint8
+{
+	// Bitonic sorting network, O(n log^2 n)
+	Bitonic,
+	// LSD radix sort over the distance keys, O(n). Always sorts key/index pairs, independent of the sort mode.
+	Radix,
+	// Multithreaded radix sort on the CPU, the result is uploaded to the output textures. Used automatically below SM5.
+	CPU
+};
+
+/************************************************************************/
+/* How the points are stored in the buffers and output textures         */
+/************************************************************************/
+enum class EPointFormat : uint8
+{
+	// float4 positions and float4 linear colors (PF_A32B32G32R32F textures)
+	Float32,
+	// Positions quantized to 16 bit per component within the point bounds, RGBA8 colors.
+	// The position texture (PF_A16B16G16R16) holds the normalized position within the bounds and the valid flag in alpha,
+	// the color texture is PF_R8G8B8A8. Needs a GPU strategy.
+	Compact
+};
+
+/************************************************************************/
+/* Which work the last execution did (see SetIncrementalSort)           */
+/************************************************************************/
+enum class ESortPath : uint8
+{
+	// Nothing has been sorted yet
+	None,
+	// Neither the camera nor the data changed, the previous result was kept
+	Skipped,
+	// The previous order was fixed up with a few block-local sort passes
+	Incremental,
+	// The points were sorted from scratch
+	Full,
+	// The order of the cached view direction closest to the camera was fixed up (see SetViewOrderCache)
+	ViewOrder
+};
+
+// Staging copies that can be on their way to the CPU at once (see FComputeShader::RequestSortedPointReadback)
+const int32 SORT_READBACK_RING_SIZE = 3;
+
+// Directions of the view order cache sorted per execution while it is built, and the distance of their cameras to the
+// center of the bounds (in bounding sphere radii, see FComputeShader::SetViewOrderCache)
+const int32 VIEW_ORDER_BINS_PER_EXECUTION = 1;
+const float VIEW_ORDER_CAMERA_DISTANCE = 2.0f;
+
+/************************************************************************/
+/* Copy of the sorted point positions on the CPU, e.g. for picking or   */
+/* LOD bookkeeping (see FComputeShader::RequestSortedPointReadback)     */
+/************************************************************************/
+struct COMPUTESHADER_API FSortedPointReadback
+{
+	// Size of the position texture, the sorted points are stored column by column
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	// Points of the sort, the texels behind them hold padding points
+	int32 NumPoints = 0;
+	EPointFormat PointFormat = EPointFormat::Float32;
+	// Bounds the compact positions are normalized to
+	FVector BoundsMin = FVector::ZeroVector;
+	FVector BoundsSize = FVector(1.0f);
+	// Texels of the position texture row by row (float4, or 4 x uint16 for the compact format)
+	TArray<uint8> Texels;
+
+	// Position in the space of the input data, zero for invalid (and culled) points
+	FVector4 GetTexelPos(int32 X, int32 Y) const;
+	// Position of the i-th point in the sorted order (back to front by default, see FComputeShader::SetSortKey)
+	FVector4 GetSortedPointPos(int32 SortedIndex) const { return GetTexelPos(SortedIndex / SizeY, SortedIndex % SizeY); }
+};
+
+// Called on the game thread with the copied result
+typedef TFunction<void(const FSortedPointReadback&)> FOnSortedPointReadback;
 
 /***************************************************************************/
 /* This class demonstrates how to use the compute shader we have declared. */
@@ -40,80 +128,444 @@ const UINT MATRIX_HEIGHT = NUM_ELEMENTS / BITONIC_BLOCK_SIZE;
 class COMPUTESHADER_API FComputeShader
 {
 public:
+	/************************************************************************/
+	/* @param NumElements - Number of points to sort. Internally padded to  */
+	/* the next power of two (at least BITONIC_BLOCK_SIZE), the size of the */
+	/* output textures is chosen accordingly.                               */
+	/************************************************************************/
+	FComputeShader(float SimulationSpeed, int32 NumElements, ERHIFeatureLevel::Type ShaderFeatureLevel);
+	// Legacy constructor: sorts SizeX * SizeY points into output textures of the given size
 	FComputeShader(float SimulationSpeed, int32 SizeX, int32 SizeY, ERHIFeatureLevel::Type ShaderFeatureLevel);
 	~FComputeShader();
 
+	/************************************************************************/
+	/* Changes the number of points to sort. Reallocates all buffers and    */
+	/* textures (flushes the rendering commands), so avoid calling it often */
+	/************************************************************************/
+	void SetNumElements(int32 NumElements);
+
+	/************************************************************************/
+	/* Switches between sorting the full point data and sorting key/index   */
+	/* pairs with a final gather pass. Re-uploads the point data.           */
+	/************************************************************************/
+	void SetSortMode(ESortMode Mode);
+	ESortMode GetSortMode() const { return SortMode; }
+
+	/************************************************************************/
+	/* Chooses the sorting algorithm of this instance. Switching between    */
+	/* the CPU and the GPU strategies reallocates all resources.            */
+	/************************************************************************/
+	void SetSortStrategy(ESortStrategy Strategy);
+	ESortStrategy GetSortStrategy() const { return SortStrategy; }
+
+	/************************************************************************/
+	/* Chooses how the bitonic strategy sorts the levels beyond the thread  */
+	/* group size: GlobalMerge (default) merges the large strides in device */
+	/* memory, several steps per pass, Transpose sorts the columns of the   */
+	/* transposed matrix. See ComputeShader.BenchmarkBitonicSchedules.      */
+	/************************************************************************/
+	void SetBitonicSchedule(EBitonicScheduleType ScheduleType);
+	EBitonicScheduleType GetBitonicSchedule() const { return BitonicScheduleType; }
+
+	/************************************************************************/
+	/* Chooses the storage format of the point data. The compact format     */
+	/* quantizes the positions relative to Bounds (the bounds of the point  */
+	/* cloud in object space). Changing the format reallocates all buffers  */
+	/* and textures, the current points are converted (new compact bounds   */
+	/* pack them again). Float32 data doesn't depend on the bounds.         */
+	/* The CPU strategy always uses Float32.                                */
+	/************************************************************************/
+	void SetPointFormat(EPointFormat Format, const FBox& Bounds = FBox(ForceInit));
+	EPointFormat GetPointFormat() const { return PointFormat; }
+
+	/************************************************************************/
+	/* Chooses what the points are sorted by: the key type, the order and   */
+	/* the mapping of the positions to the space of the camera. Each        */
+	/* combination selects its own specialized key kernels, the sorting     */
+	/* networks are shared. The default is the squared distance, back to    */
+	/* front, pos.gbr. View depth keys need a view direction (the overloads */
+	/* of ExecuteComputeShader that pass or derive one). Invalidates the    */
+	/* last order and the view order cache.                                 */
+	/************************************************************************/
+	void SetSortKey(const FPointSortKey& Key);
+	const FPointSortKey& GetSortKey() const { return SortKey; }
+
+	/************************************************************************/
+	/* Enables the incremental re-sort for small camera movements: the last */
+	/* order is kept and only NumFixupPasses block-local sort passes (each  */
+	/* moves a point by up to half a block) run if the camera moved less    */
+	/* than MaxCameraDelta. Large jumps run a full sort, as well as every   */
+	/* FullSortInterval-th execution (0 = never forced).                    */
+	/* An unchanged camera never triggers any work.                         */
+	/************************************************************************/
+	void SetIncrementalSort(bool bEnable, float MaxCameraDelta = 10.0f, int32 NumFixupPasses = 4, int32 FullSortInterval = 60);
+	bool IsIncrementalSortEnabled() const { return bIncrementalSort; }
+
+	// The path taken by the last execution on the render thread
+	ESortPath GetLastSortPath() const { return LastSortPath; }
+
+	/************************************************************************/
+	/* View order cache for static point clouds: outside of the bounds, the */
+	/* order depends almost only on the view direction. The sorted indices  */
+	/* of NumBins directions (evenly spread over the sphere) are built in   */
+	/* the background with the key sorts, VIEW_ORDER_BINS_PER_EXECUTION per */
+	/* execution (4 bytes per point and direction). Once complete, cameras  */
+	/* outside of Bounds load the order of the closest direction and fix it */
+	/* up with NumFixupPasses block passes instead of sorting. Cameras      */
+	/* inside of Bounds, culling requests and batches sort as usual. New    */
+	/* point data invalidates the cache. Needs a GPU key sort (switches the */
+	/* payload mode to the key/index mode).                                 */
+	/* @param Bounds - Bounds of the points in the space of the camera      */
+	/************************************************************************/
+	void SetViewOrderCache(bool bEnable, const FBox& Bounds = FBox(ForceInit), int32 NumBins = 26, int32 NumFixupPasses = 2);
+	bool IsViewOrderCacheEnabled() const { return NumViewOrderBins > 0; }
+	bool IsViewOrderCacheComplete() const { return NumViewOrderBins > 0 && NumViewOrderBinsBuilt.GetValue() == NumViewOrderBins; }
+
+	/************************************************************************/
+	/* Runs the GPU sort on the async compute pipe (if the RHI supports it  */
+	/* efficiently), overlapping with the graphics work of the frame. The   */
+	/* result is swapped in on the next frame, whether or not another sort  */
+	/* is requested, so the textures are at most one frame old. These sorts */
+	/* have no GPU timings (FPointSortTimings counts them as not measured). */
+	/* Enabled by default.                                                  */
+	/************************************************************************/
+	void SetAsyncCompute(bool bEnable);
+	bool IsAsyncComputeEnabled() const { return bAsyncCompute; }
+
+	int32 GetNumElements() const { return NumElements; }
+	int32 GetPaddedNumElements() const { return PaddedNumElements; }
+
 	/************************************************************************/
 	/* Run this to execute the compute shader once!                         */
+	/* Can be called at any rate: requests that arrive before the render    */
+	/* thread picks them up are merged, only the newest camera is sorted.   */
 	/* @param currentCamPos - The current camera position ! in object space ! of the point cloud proxy mesh.  */
 	/************************************************************************/
 	void ExecuteComputeShader(FVector4 currentCamPos);
 
+	/************************************************************************/
+	/* Same as above, but culls the points against the view frustum first:  */
+	/* invalid points and points outside of the frustum are compacted away  */
+	/* and written as invalid (zero) points behind the visible ones. Culled */
+	/* requests are always sorted by the radix sort, which only sorts the   */
+	/* visible points (indirect dispatches, no readback). Only the GPU key  */
+	/* sorts (key/index mode or radix strategy) cull. The view direction of */
+	/* the view depth keys is taken from the w column of the (perspective)  */
+	/* projection.                                                          */
+	/* @param LocalToClip - Object space of the point cloud to clip space   */
+	/************************************************************************/
+	void ExecuteComputeShader(FVector4 currentCamPos, const FMatrix& LocalToClip);
+
+	// Sorts for the camera position and its view direction (in the same space, normalized here), used by the view depth keys
+	void ExecuteComputeShader(FVector4 currentCamPos, const FVector& ViewDirection);
+
+	/************************************************************************/
+	/* Batched sorting (see FComputeShaderBatch): the points form separate  */
+	/* point clouds [Start, Start + Count) (packed, sorted by Start) that   */
+	/* are sorted independently within one dispatch sequence. The CamPos of */
+	/* the segments is ignored here. Needs a key/index sort (switches the   */
+	/* payload mode to the key/index mode), not available on the CPU.       */
+	/* The sorted points of a segment stay in [Start, Start + Count).       */
+	/************************************************************************/
+	void SetPointSegments(const TArray<FPointSegment>& Segments);
+	int32 GetNumPointSegments() const { return NumPointSegments; }
+
+	// Sorts each segment for its own camera position (in the object space of its point cloud), NumSegments has to match SetPointSegments.
+	// The view directions (normalized, may be null) are only used by the view depth keys.
+	void ExecuteComputeShader(const FVector4* SegmentCamPos, int32 NumSegments, const FVector4* SegmentViewDir = nullptr);
+
 	/************************************************************************/
 	/* Only execute this from the render thread!!!                          */
+	/* Executes the newest request, if there is one that is not done yet.   */
 	/************************************************************************/
 	void ExecuteComputeShaderInternal();
 
 	/************************************************************************/
-	/* Save a screenshot of the target to the project saved folder          */
+	/* Save a screenshot of the sorted positions to the screenshot folder   */
+	/* (VisualizeTexture.bmp), read back like RequestSortedPointReadback    */
 	/************************************************************************/
-	void Save()
-	{
-		bSave = true;
-	}
-
-	FTexture2DRHIRef GetSortedPointPosTexture() { return m_SortedPointPosTex; }
-	FTexture2DRHIRef GetSortedPointColorsTexture() { return m_SortedPointColorsTex; }
-
-	// Send the reference to the point position data to the compute shader
-	void SetPointPosDataReference(TArray<FLinearColor>* data) {
-		check(data->Num() <= NUM_ELEMENTS);
-		for (int i = 0; i < data->Num(); ++i)
-			PointPosData[i] = FVector4((*data)[i]);
-	}
-
-	// Send the reference to the point color data to the compute shader (RGBA-encoded)
-	void SetPointColorDataReference(TArray<uint8>* data) {
-		check(data->Num() <= NUM_ELEMENTS*4);
-		for (int i = 0; i < int(data->Num() / 4); i++) {
-			FColor color = FColor(((float)(*data)[i * 4 + 2]), ((float)(*data)[i * 4 + 1]), ((float)(*data)[i * 4]), ((float)(*data)[i * 4 + 3]));
-			PointColorData[i] = FVector4(FLinearColor(color));
-		}
-	}
+	void Save();
+
+	/************************************************************************/
+	/* Copies the latest published sort result (the positions in back to    */
+	/* front order) to the CPU without blocking: the texture is copied into */
+	/* one of SORT_READBACK_RING_SIZE staging textures, a GPU fence is      */
+	/* polled once per frame and the data is handed to the callback on the  */
+	/* game thread a few frames later. Requests wait while all staging      */
+	/* textures are in flight or nothing has been sorted yet.               */
+	/************************************************************************/
+	void RequestSortedPointReadback(FOnSortedPointReadback Callback);
+
+	// The output textures holding the latest complete result. The sort writes into a second set of textures meanwhile.
+	FTexture2DRHIRef GetSortedPointPosTexture() { return m_SortedPointPosTex[ReadOutputIndex.GetValue()]; }
+	FTexture2DRHIRef GetSortedPointColorsTexture() { return m_SortedPointColorsTex[ReadOutputIndex.GetValue()]; }
+
+	/************************************************************************/
+	/* Views of the same textures for vertex factories and global shaders   */
+	/* that read the sorted points directly, without a render target in     */
+	/* between (render thread). Point i is at texel (i / SizeY, i % SizeY). */
+	/************************************************************************/
+	FShaderResourceViewRHIRef GetSortedPointPosSRV() { return m_SortedPointPosTex_SRV[ReadOutputIndex.GetValue()]; }
+	FShaderResourceViewRHIRef GetSortedPointColorsSRV() { return m_SortedPointColorsTex_SRV[ReadOutputIndex.GetValue()]; }
+
+	/************************************************************************/
+	/* Fast path for materials that sample render targets: copies the       */
+	/* latest result into them on the GPU, without a draw (replaces         */
+	/* FPixelShader::ExecutePixelShader). The render targets need the size  */
+	/* and the format of the output textures (RTF_RGBA32f, float format     */
+	/* only), returns false otherwise.                                      */
+	/************************************************************************/
+	bool CopySortedPointsToRenderTargets(UTextureRenderTarget2D* PointPosRT, UTextureRenderTarget2D* PointColorsRT);
+
+	/************************************************************************/
+	/* Fast path: streams caller-owned point data that is already in the    */
+	/* GPU layout (float4 positions, float4 linear colors) directly into    */
+	/* the persistent buffers on the render thread, without conversion and  */
+	/* without reallocating (unless Num exceeds the current problem size).  */
+	/* The memory has to stay valid until IsPointDataUploadPending() is     */
+	/* false. Points behind Num are invalidated.                            */
+	/************************************************************************/
+	void SetPointData(const FVector4* PointPos, const FVector4* PointColors, int32 Num);
+	bool IsPointDataUploadPending() const { return !PointDataUploadFence.IsFenceComplete(); }
+
+	/************************************************************************/
+	/* Replaces the points [StartIndex, StartIndex + Count) (GPU layout).   */
+	/* The data is copied into a render command, so it stays in order with  */
+	/* SetPointData. Only the changed ranges are uploaded on the render     */
+	/* thread (adjacent ranges are merged). Needs the key/index mode or the */
+	/* radix strategy: the payload mode sorts the buffers in place, so it   */
+	/* falls back to a full upload of the data arrays.                      */
+	/************************************************************************/
+	void UpdatePointRange(int32 StartIndex, int32 Count, const FVector4* PointPos, const FVector4* PointColors);
+
+	// Send the reference to the point position data to the compute shader (grows the problem size if necessary).
+	// The points are converted and passed to the render thread, UpdateDataInShader uploads them.
+	void SetPointPosDataReference(TArray<FLinearColor>* data);
+
+	// Send the reference to the point color data to the compute shader (RGBA-encoded, grows the problem size if necessary)
+	void SetPointColorDataReference(TArray<uint8>* data);
 
 	// Should be called when the point and/or position data in the shader should be updated (affects performance!)
-	void UpdateDataInShader() {
-		bUpdateDataInShader = true;
-	}
+	void UpdateDataInShader();
 
 private:
-	void ParallelBitonicSort(FRHICommandListImmediate& RHICmdList);
-	void SaveScreenshot(FRHICommandListImmediate& RHICmdList);
+	void CreateResources(int32 SizeX, int32 SizeY);
+	void ReleaseResources();
+	void CreateSortKeyBuffers();
+	void CreatePayloadSortBuffers();
+	void CreateSortPassTable();
+	bool NeedsPayloadSortBuffers() const { return SortMode == ESortMode::Payload && SortStrategy == ESortStrategy::Bitonic; }
+	FPointFormatPermutationDomain GetPointFormatPermutation() const;
+	FPointSortKeyPermutationDomain GetPointSortKeyPermutation() const;
+	uint32 GetPointPosStride() const;
+	uint32 GetPointColorStride() const;
+	void WritePointData(void* PointPosDest, void* PointColorDest, const FVector4* InPointPos, const FVector4* InPointColors, int32 Num) const;
+	/** A range of points [Start, Start + Count) */
+	struct FPointRange
+	{
+		int32 Start;
+		int32 Count;
+	};
+
+	bool UpdateDataBuffers();
+	bool UploadDirtyRanges(TArray<FPointRange>& Ranges);
+	void ApplyPointRange(const FPointRange& Range, const TArray<FVector4>& InPointPos, const TArray<FVector4>& InPointColors);
+	void UploadPointData(const FVector4* PointPos, const FVector4* PointColors, int32 Num);
+	void PublishSortRequest(const FSortRequest& Request);
+	void UpdatePointSegmentsBuffer(const FSortRequest& Request);
+	ESortPath ChooseSortPath(bool bDataChanged, const FSortRequest& Request) const;
+	bool CanUseViewOrderCache(const FSortRequest& Request) const;
+	bool NeedsViewOrderBins() const;
+	void InvalidateViewOrderBins();
+	void SortOnAsyncCompute(FRHICommandListImmediate& RHICmdList, ESortPath SortPath);
+	void GetSortWorkUAVs(TArray<FUnorderedAccessViewRHIParamRef>& OutUAVs) const;
+	void PublishSortResult(FRHICommandListImmediate& RHICmdList);
+
+	/** Publishes the async compute result and polls the readbacks once per frame while they wait, independent of the next request */
+	bool TickPendingGPUWork(float DeltaTime);
+	void PollPendingGPUWork();
+	void UpdatePendingGPUWork();
+
+	/** The GPU sorting routines, recorded on the graphics or on the async compute command list */
+	template<typename TRHICmdList> void DispatchSort(TRHICmdList& RHICmdList, ESortPath SortPath);
+	template<typename TRHICmdList> void ParallelBitonicSort(TRHICmdList& RHICmdList);
+	template<typename TRHICmdList> void IncrementalSort(TRHICmdList& RHICmdList);
+	template<typename TRHICmdList> void IncrementalSortKeys(TRHICmdList& RHICmdList);
+	template<typename TRHICmdList> void BlockSortKeys(TRHICmdList& RHICmdList, int32 NumPasses);
+	template<typename TRHICmdList> void ViewOrderSortKeys(TRHICmdList& RHICmdList);
+	template<typename TRHICmdList> void BuildViewOrderBins(TRHICmdList& RHICmdList);
+	template<typename TRHICmdList> void ParallelBitonicSortKeys(TRHICmdList& RHICmdList);
+	template<typename TRHICmdList> void ParallelRadixSortKeys(TRHICmdList& RHICmdList);
+	template<typename TRHICmdList> void DispatchRadixGroups(TRHICmdList& RHICmdList, FComputeShaderRadixDeclaration* Shader, uint32 NumGroups);
+	template<typename TRHICmdList> void GenerateSortKeys(TRHICmdList& RHICmdList);
+	template<typename TRHICmdList> void CullSortKeys(TRHICmdList& RHICmdList);
+	template<typename TRHICmdList> void GeneratePointKeys(TRHICmdList& RHICmdList);
+	template<typename TRHICmdList> void GatherSortedPoints(TRHICmdList& RHICmdList, int32 SortKeysBufferIndex);
+	void SortOnCPU();
+	void UpdatePointReadbacks(FRHICommandListImmediate& RHICmdList);
+	void ReleasePointReadbacks();
 
-	bool bIsComputeShaderExecuting;
 	bool bIsUnloading;
-	bool bSave;
 	bool bUpdateDataInShader = true;
+	ESortMode SortMode = ESortMode::Payload;
+	ESortStrategy SortStrategy = ESortStrategy::Bitonic;
+	EPointFormat PointFormat = EPointFormat::Float32;
+	FPointSortKey SortKey;
+	EBitonicScheduleType BitonicScheduleType = EBitonicScheduleType::GlobalMerge;
+
+	/** Incremental re-sort settings and the state of the last sort */
+	bool bIncrementalSort = false;
+	float IncrementalMaxCameraDelta = 10.0f;
+	int32 IncrementalNumFixupPasses = 4;
+	int32 IncrementalFullSortInterval = 60;
+	int32 NumSortsSinceFullSort = 0;
+	bool bHasSortResult = false;
+	FSortRequest LastSortRequest;
+
+	/** The key buffers hold the order of the last sort, which the key fix-up passes start from (render thread) */
+	bool bSortKeysHoldLastOrder = false;
+
+	/** The current request culls the points (render thread) */
+	bool bCullPoints = false;
+	ESortPath LastSortPath = ESortPath::None;
+
+	/** Number of points and the power of two they are padded to */
+	int32 NumElements;
+	int32 PaddedNumElements;
 
 	FComputeShaderConstantParameters ConstantParameters;
 	FComputeShaderVariableParameters VariableParameters;
+
+	/** The uniform buffers of all dispatches: the constants are created when they have changed, the variables once per sort (render thread) */
+	FComputeShaderConstantParametersRef ConstantParametersBuffer;
+	FComputeShaderVariableParametersRef VariableParametersBuffer;
 	ERHIFeatureLevel::Type FeatureLevel;
 
-	/** Main textures */
-	FTexture2DRHIRef m_SortedPointPosTex;
-	FTexture2DRHIRef m_SortedPointColorsTex;
+	/** The newest sort request of the game thread */
+	FSortRequestMailbox SortRequests;
+
+	/** Point clouds of a batch: the number (game thread) and the layout (render thread) */
+	int32 NumPointSegments = 0;
+	TArray<FPointSegment> PointSegments;
+
+	/** The segments with the cameras of the current request */
+	FStructuredBufferRHIRef m_PointSegmentsBuffer;
+	FShaderResourceViewRHIRef m_PointSegmentsBuffer_SRV;
+
+	/** Main textures, double buffered: the sort writes into one set while the other one is read */
+	FTexture2DRHIRef m_SortedPointPosTex[2];
+	FTexture2DRHIRef m_SortedPointColorsTex[2];
+
+	/** The set holding the latest complete result (read on the game thread), the set the next sort writes into (render thread) */
+	FThreadSafeCounter ReadOutputIndex;
+	int32 WriteOutputIndex = 1;
+
+	/** A sort has been written to the write set but not been published yet, the read set holds a result (render thread) */
+	bool bSortResultPending = false;
+	bool bHasPublishedResult = false;
+	bool bSortResultOnAsyncCompute = false;
+	bool bAsyncCompute = true;
+
+	/** Set by the render thread while there is GPU work to poll, checked by the ticker on the game thread */
+	FThreadSafeBool bHasPendingGPUWork;
+	FDelegateHandle PollTickerHandle;
+
+	/** Hand the resources over from the graphics to the async compute pipe and back */
+	FComputeFenceRHIRef SortStartFence;
+	FComputeFenceRHIRef SortDoneFence;
+
+	/** Working buffers for the shader (the second one is the source of the transposes, payload bitonic sort only) */
+	FStructuredBufferRHIRef m_PointPosDataBuffer;
+	FStructuredBufferRHIRef m_PointPosDataBuffer2;
+	FStructuredBufferRHIRef m_PointColorsDataBuffer;
+	FStructuredBufferRHIRef m_PointColorsDataBuffer2;
+
+	/** Sort keys of the points in payload bitonic mode, computed once per frame and permuted together with the points */
+	FStructuredBufferRHIRef m_PointKeysBuffer;
+	FStructuredBufferRHIRef m_PointKeysBuffer2;
+	FUnorderedAccessViewRHIRef m_PointKeysBuffer_UAV;
+	FUnorderedAccessViewRHIRef m_PointKeysBuffer_UAV2;
+
+	/** Key/index pairs (key/index mode only), the transposes ping-pong between both buffers */
+	FStructuredBufferRHIRef m_SortKeysBuffer[2];
+	FUnorderedAccessViewRHIRef m_SortKeysBuffer_UAV[2];
+	int32 SortKeysResultIndex = 0;
+
+	/** Digit counters per thread group (radix sort only) */
+	FStructuredBufferRHIRef m_RadixCountersBuffer;
+	FUnorderedAccessViewRHIRef m_RadixCountersBuffer_UAV;
+
+	/** Visible points per thread group and their total, and the thread groups of the radix sort over the visible points (culling only) */
+	FStructuredBufferRHIRef m_CullCountersBuffer;
+	FUnorderedAccessViewRHIRef m_CullCountersBuffer_UAV;
+	FVertexBufferRHIRef m_CullDispatchArgsBuffer;
+	FUnorderedAccessViewRHIRef m_CullDispatchArgsBuffer_UAV;
+	FShaderResourceViewRHIRef m_CullDispatchArgsBuffer_SRV;
 
-	/** Working buffer for the shader */
-	FStructuredBufferRHIParamRef m_PointPosDataBuffer;
-	FStructuredBufferRHIParamRef m_PointColorsDataBuffer;
+	/** Read-only views of the unsorted point data for the key/index mode */
+	FShaderResourceViewRHIRef m_PointPosDataBuffer_SRV;
+	FShaderResourceViewRHIRef m_PointColorsDataBuffer_SRV;
 
-	/** Input data */
+	/** A direction of the view order cache and the point indices sorted for it */
+	struct FViewOrderBin
+	{
+		FVector Direction;
+		FStructuredBufferRHIRef Buffer;
+		FUnorderedAccessViewRHIRef UAV;
+		bool bValid = false;
+	};
+
+	/** The directions of the view order cache, the bounds and the fix-up passes (render thread), the number of directions (game thread) */
+	TArray<FViewOrderBin> ViewOrderBins;
+	FBox ViewOrderBounds = FBox(ForceInit);
+	int32 ViewOrderNumFixupPasses = 2;
+	int32 NumViewOrderBins = 0;
+
+	/** Directions whose order is up to date (written on the render thread) */
+	FThreadSafeCounter NumViewOrderBinsBuilt;
+
+	/** Working memory of the CPU strategy */
+	FComputeShaderCPUSort CPUSort;
+
+	/** Planned dispatches for the current problem size, and their constants (one row per pass, see SortPasses.ush) */
+	TArray<FBitonicSortPass> SortSchedule;
+	FStructuredBufferRHIRef m_SortPassTableBuffer;
+	FShaderResourceViewRHIRef m_SortPassTableBuffer_SRV;
+
+	/** Ranges changed by UpdatePointRange that still have to be uploaded (render thread, the data is already in the data arrays) */
+	TArray<FPointRange> DirtyRanges;
+
+	/** A copy of the position texture on its way to the CPU */
+	struct FPointReadbackSlot
+	{
+		FTexture2DRHIRef StagingTex;
+		FGPUFenceRHIRef Fence;
+		TSharedPtr<FSortedPointReadback, ESPMode::ThreadSafe> Result;
+		FOnSortedPointReadback Callback;
+		bool bInFlight = false;
+	};
+
+	/** Readbacks in flight, and the requests waiting for a result or a free slot (render thread) */
+	FPointReadbackSlot PointReadbacks[SORT_READBACK_RING_SIZE];
+	TArray<FOnSortedPointReadback> PendingPointReadbacks;
+
+	/** GPU timestamps of the sort phases (render thread), aggregated in FPointSortTimings */
+	FPointSortGPUTimer GPUTimer;
+
+	/** Signals when the render thread is done with the memory passed to SetPointData */
+	FRenderCommandFence PointDataUploadFence;
+
+	/** The current points in the GPU layout, owned by the render thread: written by the commands of the point setters, read by the uploads and the CPU sort */
 	TResourceArray<FVector4> PointPosData;
 	TResourceArray<FVector4> PointColorData;
 
 	/** We need a UAV if we want to be able to write to the resource*/
-	FUnorderedAccessViewRHIRef m_SortedPointPosTex_UAV;
-	FUnorderedAccessViewRHIRef m_SortedPointColorsTex_UAV;
+	FUnorderedAccessViewRHIRef m_SortedPointPosTex_UAV[2];
+	FUnorderedAccessViewRHIRef m_SortedPointColorsTex_UAV[2];
+
+	/** Read views of the output textures */
+	FShaderResourceViewRHIRef m_SortedPointPosTex_SRV[2];
+	FShaderResourceViewRHIRef m_SortedPointColorsTex_SRV[2];
 	FUnorderedAccessViewRHIRef m_PointPosDataBuffer_UAV;
 	FUnorderedAccessViewRHIRef m_PointPosDataBuffer_UAV2;
 	FUnorderedAccessViewRHIRef m_PointColorsDataBuffer_UAV;
@@ -36,24 +36,20 @@ IMPLEMENT_UNIFORM_BUFFER_STRUCT(FPixelShaderConstantParameters,
 	FPixelShaderDeclaration::FPixelShaderDeclaration(const
 		ShaderMetaType::CompiledShaderInitializerType& Initializer)
 	: FGlobalShader(Initializer) {
-	//This call is what lets the shader system know that the surface OutputSurface is going to be available in the shader. The second parameter is the name it will be known by in the shader
-	TextureParameter.Bind(Initializer.ParameterMap,
-		TEXT("TextureParameter"));  //The text parameter here is the name of the parameter in the shader
+	//This call is what lets the shader system know that the input surfaces are going to be available in the shader. The second parameter is the name it will be known by in the shader
+	for (int32 i = 0; i < MAX_PIXEL_SHADER_TARGETS; ++i)
+		TextureParameters[i].Bind(Initializer.ParameterMap, *FString::Printf(TEXT("TextureParameter%d"), i));
 }
 
-void FPixelShaderDeclaration::SetUniformBuffers(FRHICommandList& RHICmdList,
-	FPixelShaderConstantParameters& ConstantParameters,
-	FPixelShaderVariableParameters& VariableParameters) {
-	FPixelShaderConstantParametersRef ConstantParametersBuffer;
-	FPixelShaderVariableParametersRef VariableParametersBuffer;
-
-	ConstantParametersBuffer =
-		FPixelShaderConstantParametersRef::CreateUniformBufferImmediate(
-			ConstantParameters, UniformBuffer_SingleDraw);
-	VariableParametersBuffer =
-		FPixelShaderVariableParametersRef::CreateUniformBufferImmediate(
-			VariableParameters, UniformBuffer_SingleDraw);
+void FPixelShaderDeclaration::ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+{
+	FGlobalShader::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+	FPermutationDomain(Parameters.PermutationId).ModifyCompilationEnvironment(OutEnvironment);
+}
 
+void FPixelShaderDeclaration::SetUniformBuffers(FRHICommandList& RHICmdList,
+	const FPixelShaderConstantParametersRef& ConstantParametersBuffer,
+	const FPixelShaderVariableParametersRef& VariableParametersBuffer) {
 	SetUniformBufferParameter(RHICmdList, GetPixelShader(),
 		GetUniformBufferParameter<FPixelShaderConstantParameters>(),
 		ConstantParametersBuffer);
@@ -62,22 +58,27 @@ void FPixelShaderDeclaration::SetUniformBuffers(FRHICommandList& RHICmdList,
 		VariableParametersBuffer);
 }
 
-void FPixelShaderDeclaration::SetOutputTexture(FRHICommandList& RHICmdList,
-	FShaderResourceViewRHIRef TextureParameterSRV) {
+void FPixelShaderDeclaration::SetInputTextures(FRHICommandList& RHICmdList,
+	const FShaderResourceViewRHIRef* TextureParameterSRVs, int32 NumTextures) {
 	FPixelShaderRHIParamRef PixelShaderRHI = GetPixelShader();
 
-	if (TextureParameter.IsBound()) { //This actually sets the shader resource view to the texture parameter in the shader :)
-		RHICmdList.SetShaderResourceViewParameter(PixelShaderRHI,
-			TextureParameter.GetBaseIndex(), TextureParameterSRV);
+	check(NumTextures <= MAX_PIXEL_SHADER_TARGETS);
+	for (int32 i = 0; i < NumTextures; ++i) {
+		if (TextureParameters[i].IsBound()) { //This actually sets the shader resource view to the texture parameter in the shader :)
+			RHICmdList.SetShaderResourceViewParameter(PixelShaderRHI,
+				TextureParameters[i].GetBaseIndex(), TextureParameterSRVs[i]);
+		}
 	}
 }
 
 void FPixelShaderDeclaration::UnbindBuffers(FRHICommandList& RHICmdList) {
 	FPixelShaderRHIParamRef PixelShaderRHI = GetPixelShader();
 
-	if (TextureParameter.IsBound()) {
-		RHICmdList.SetShaderResourceViewParameter(PixelShaderRHI,
-			TextureParameter.GetBaseIndex(), FShaderResourceViewRHIParamRef());
+	for (FShaderResourceParameter& TextureParameter : TextureParameters) {
+		if (TextureParameter.IsBound()) {
+			RHICmdList.SetShaderResourceViewParameter(PixelShaderRHI,
+				TextureParameter.GetBaseIndex(), FShaderResourceViewRHIParamRef());
+		}
 	}
 }
 
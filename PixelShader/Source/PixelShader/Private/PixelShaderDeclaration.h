@@ -42,6 +42,12 @@ END_UNIFORM_BUFFER_STRUCT(FPixelShaderVariableParameters)
 typedef TUniformBufferRef<FPixelShaderConstantParameters> FPixelShaderConstantParametersRef;
 typedef TUniformBufferRef<FPixelShaderVariableParameters> FPixelShaderVariableParametersRef;
 
+// Input texture / render target pairs that are drawn in a single pass (simultaneous render targets)
+const int32 MAX_PIXEL_SHADER_TARGETS = 4;
+
+class FPixelShaderNumTargetsDim : SHADER_PERMUTATION_RANGE_INT("NUM_TARGETS", 1, MAX_PIXEL_SHADER_TARGETS);
+typedef TShaderPermutationDomain<FPixelShaderNumTargetsDim> FPixelShaderPermutationDomain;
+
 /************************************************************************/
 /* This is the type we use as vertices for our fullscreen quad.         */
 /************************************************************************/
@@ -75,6 +81,30 @@ public:
 	}
 };
 
+/************************************************************************/
+/* A single triangle that covers the whole viewport (the uvs run from   */
+/* 0 to 2, so the visible part maps to 0..1). It is created once and    */
+/* replaces the quad that was uploaded with every draw.                 */
+/************************************************************************/
+class FFullscreenTriangleVertexBuffer : public FVertexBuffer
+{
+public:
+	virtual void InitRHI() override
+	{
+		FRHIResourceCreateInfo CreateInfo;
+		VertexBufferRHI = RHICreateVertexBuffer(sizeof(FTextureVertex) * 3, BUF_Static, CreateInfo);
+
+		FTextureVertex* Vertices = (FTextureVertex*)RHILockVertexBuffer(VertexBufferRHI, 0, sizeof(FTextureVertex) * 3, RLM_WriteOnly);
+		Vertices[0].Position = FVector4(-1.0f, 1.0f, 0, 1.0f);
+		Vertices[1].Position = FVector4(3.0f, 1.0f, 0, 1.0f);
+		Vertices[2].Position = FVector4(-1.0f, -3.0f, 0, 1.0f);
+		Vertices[0].UV = FVector2D(0, 0);
+		Vertices[1].UV = FVector2D(2, 0);
+		Vertices[2].UV = FVector2D(0, 2);
+		RHIUnlockVertexBuffer(VertexBufferRHI);
+	}
+};
+
 /************************************************************************/
 /* A simple passthrough vertexshader that we will use.                  */
 /************************************************************************/
@@ -104,6 +134,8 @@ class FPixelShaderDeclaration : public FGlobalShader
 	DECLARE_SHADER_TYPE(FPixelShaderDeclaration, Global);
 
 public:
+	// One permutation per number of render targets, each input texture is written to the render target with the same index
+	typedef FPixelShaderPermutationDomain FPermutationDomain;
 
 	FPixelShaderDeclaration() {}
 
@@ -113,24 +145,27 @@ public:
 		return true;
 	};
 
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment);
+
 	virtual bool Serialize(FArchive& Ar) override
 	{
 		bool bShaderHasOutdatedParams = FGlobalShader::Serialize(Ar);
 
-		Ar << TextureParameter;
+		for (FShaderResourceParameter& TextureParameter : TextureParameters)
+			Ar << TextureParameter;
 
 		return bShaderHasOutdatedParams;
 	}
 
-	//This function is required to let us bind our runtime surface to the shader using an SRV.
-	void SetOutputTexture(FRHICommandList& RHICmdList, FShaderResourceViewRHIRef TextureParameterSRV);
-	//This function is required to bind our constant / uniform buffers to the shader.
-	void SetUniformBuffers(FRHICommandList& RHICmdList, FPixelShaderConstantParameters& ConstantParameters, FPixelShaderVariableParameters& VariableParameters);
+	//This function is required to let us bind our runtime surfaces to the shader using SRVs (one per render target).
+	void SetInputTextures(FRHICommandList& RHICmdList, const FShaderResourceViewRHIRef* TextureParameterSRVs, int32 NumTextures);
+	//This function is required to bind our constant / uniform buffers to the shader. The buffers are owned (and updated) by the caller.
+	void SetUniformBuffers(FRHICommandList& RHICmdList, const FPixelShaderConstantParametersRef& ConstantParametersBuffer, const FPixelShaderVariableParametersRef& VariableParametersBuffer);
 	//This is used to clean up the buffer binds after each invocation to let them be changed and used elsewhere if needed.
 	void UnbindBuffers(FRHICommandList& RHICmdList);
 
 private:
 	//This is how you declare resources that are going to be made available in the HLSL
-	FShaderResourceParameter TextureParameter;
+	FShaderResourceParameter TextureParameters[MAX_PIXEL_SHADER_TARGETS];
 };
 
@@ -29,6 +29,7 @@
 //It seems to be the convention to expose all vertex declarations as globals, and then reference them as externs in the headers where they are needed.
 //It kind of makes sense since they do not contain any parameters that change and are purely used as their names suggest, as declarations :)
 TGlobalResource<FTextureVertexDeclaration> GTextureVertexDeclaration;
+TGlobalResource<FFullscreenTriangleVertexBuffer> GFullscreenTriangleVertexBuffer;
 
 FPixelShader::FPixelShader(FColor StartColor, ERHIFeatureLevel::Type ShaderFeatureLevel)
 {
@@ -39,14 +40,11 @@ FPixelShader::FPixelShader(FColor StartColor, ERHIFeatureLevel::Type ShaderFeatu
 	
 	VariableParameters = FPixelShaderVariableParameters();
 	
-	bMustRegenerateSRV = false;
 	bIsPixelShaderExecuting = false;
 	bIsUnloading = false;
 	bSave = false;
 
 	CurrentTexture = NULL;
-	CurrentRenderTarget = NULL;
-	TextureParameterSRV = NULL;
 }
 
 FPixelShader::~FPixelShader()
@@ -55,93 +53,77 @@ FPixelShader::~FPixelShader()
 }
 
 void FPixelShader::ExecutePixelShader(UTextureRenderTarget2D* RenderTarget, FTexture2DRHIRef InputTexture, FColor EndColor, float TextureParameterBlendFactor)
+{
+	TArray<FPixelShaderTarget> Targets;
+	Targets.Add(FPixelShaderTarget{ RenderTarget, InputTexture });
+	ExecutePixelShader(Targets, EndColor, TextureParameterBlendFactor);
+}
+
+void FPixelShader::ExecutePixelShader(const TArray<FPixelShaderTarget>& Targets, FColor EndColor, float TextureParameterBlendFactor)
 {
 	check(IsInGameThread());
 
 	if (bIsUnloading || bIsPixelShaderExecuting) //Skip this execution round if we are already executing
 		return;
 
-	if (!RenderTarget)
+	if (!ensureMsgf(Targets.Num() > 0 && Targets.Num() <= MAX_PIXEL_SHADER_TARGETS, TEXT("FPixelShader draws 1 to %d targets at once"), MAX_PIXEL_SHADER_TARGETS))
 		return;
 
-	bIsPixelShaderExecuting = true;
+	//All render targets of a draw need the same size
+	for (const FPixelShaderTarget& Target : Targets)
+	{
+		if (!Target.RenderTarget)
+			return;
+		if (!ensureMsgf(Target.RenderTarget->SizeX == Targets[0].RenderTarget->SizeX && Target.RenderTarget->SizeY == Targets[0].RenderTarget->SizeY, TEXT("The render targets of FPixelShader need the same size")))
+			return;
+	}
 
-	if (TextureParameter != InputTexture)
-		bMustRegenerateSRV = true;
+	bIsPixelShaderExecuting = true;
 
 	//Now set our runtime parameters!
 	VariableParameters.EndColor = FVector4(EndColor.R / 255.0, EndColor.G / 255.0, EndColor.B / 255.0, EndColor.A / 255.0);
 	VariableParameters.TextureParameterBlendFactor = TextureParameterBlendFactor;
 
-	CurrentRenderTarget = RenderTarget;
-	TextureParameter = InputTexture;
-
 	//This macro sends the function we declare inside to be run on the render thread. What we do is essentially just send this class and tell the render thread to run the internal render function as soon as it can.
-	//I am still not 100% Certain on the thread safety of this, if you are getting crashes, depending on how advanced code you have in the start of the ExecutePixelShader function, you might have to use a lock :)
-	ENQUEUE_UNIQUE_RENDER_COMMAND_ONEPARAMETER(
+	//The targets are copied into the command, so the game thread can already prepare the next ones.
+	ENQUEUE_UNIQUE_RENDER_COMMAND_THREEPARAMETER(
 		FPixelShaderRunner,
 		FPixelShader*, PixelShader, this,
+		TArray<FPixelShaderTarget>, PixelShaderTargets, Targets,
+		FPixelShaderVariableParameters, DrawVariableParameters, VariableParameters,
 		{
-			PixelShader->ExecutePixelShaderInternal();
+			PixelShader->ExecutePixelShaderInternal(PixelShaderTargets, DrawVariableParameters);
 		}
 	);
 }
 
-void FPixelShader::ExecutePixelShaderInternal()
+FShaderResourceViewRHIRef FPixelShader::GetInputTextureSRV(FTexture2DRHIRef InputTexture)
 {
-	check(IsInRenderingThread());
-
-	if (!CurrentRenderTarget)
-		return;
-	if (!CurrentRenderTarget->GetRenderTargetResource())
-		return;
-
-	if (bIsUnloading) //If we are about to unload, so just clean up the SRV :)
-	{
-		if (NULL != TextureParameterSRV)
-		{
-			TextureParameterSRV.SafeRelease();
-			TextureParameterSRV = NULL;
-		}
-
-		return;
+	//The entry holds a reference to the texture, so its address can't be reused by another texture meanwhile
+	FInputTextureSRV* Entry = InputTextureSRVs.Find(InputTexture.GetReference());
+	if (!Entry) {
+		Entry = &InputTextureSRVs.Add(InputTexture.GetReference());
+		Entry->Texture = InputTexture;
+		Entry->SRV = RHICreateShaderResourceView(InputTexture, 0);
 	}
+	return Entry->SRV;
+}
 
-	FRHICommandListImmediate& RHICmdList = GRHICommandList.GetImmediateCommandList();
+FPixelShader::FCachedPipelineState& FPixelShader::GetPipelineState(FRHICommandList& RHICmdList, const FTextureRHIParamRef* RenderTargets, int32 NumTargets)
+{
+	FCachedPipelineState& Cached = CachedPipelineStates[NumTargets - 1];
 
-	//If our input texture reference has changed, we need to recreate our SRV
-	if (bMustRegenerateSRV)
-	{
-		bMustRegenerateSRV = false;
+	bool bFormatsChanged = false;
+	for (int32 i = 0; i < NumTargets; ++i)
+		bFormatsChanged |= Cached.RenderTargetFormats[i] != RenderTargets[i]->GetFormat();
 
-		if (NULL != TextureParameterSRV)
-		{
-			TextureParameterSRV.SafeRelease();
-			TextureParameterSRV = NULL;
-		}
+	if (Cached.PipelineState && !bFormatsChanged)
+		return Cached;
 
-		TextureParameterSRV = RHICreateShaderResourceView(TextureParameter, 0);
-	}
-
-	// This is where the magic happens
+	FPixelShaderPermutationDomain PermutationVector;
+	PermutationVector.Set<FPixelShaderNumTargetsDim>(NumTargets);
 	TShaderMapRef<FVertexShaderExample> VertexShader(GetGlobalShaderMap(FeatureLevel));
-	TShaderMapRef<FPixelShaderDeclaration> PixelShader(GetGlobalShaderMap(FeatureLevel));
-
-
-
-
-
-
-
-
-	CurrentTexture = CurrentRenderTarget->GetRenderTargetResource()->GetRenderTargetTexture();
-	SetRenderTarget(RHICmdList, CurrentTexture, FTextureRHIRef());
-	//RHICmdList.SetBlendState(TStaticBlendState<>::GetRHI());
-	//RHICmdList.SetRasterizerState(TStaticRasterizerState<>::GetRHI());
-	//RHICmdList.SetDepthStencilState(TStaticDepthStencilState<false, CF_Always>::GetRHI());
-	//static FGlobalBoundShaderState BoundShaderState;
-	//SetGlobalBoundShaderState(RHICmdList, FeatureLevel, BoundShaderState, GTextureVertexDeclaration.VertexDeclarationRHI, *VertexShader, *PixelShader);
-
+	TShaderMapRef<FPixelShaderDeclaration> PixelShader(GetGlobalShaderMap(FeatureLevel), PermutationVector);
 
 	// Replacing old GlobalBoundShaderState with the new FGraphicsPipelineState (UE 4.17)
 	FGraphicsPipelineStateInitializer GraphicsPSOInit;
@@ -149,38 +131,95 @@ void FPixelShader::ExecutePixelShaderInternal()
 	GraphicsPSOInit.BlendState = TStaticBlendState<>::GetRHI();
 	GraphicsPSOInit.RasterizerState = TStaticRasterizerState<>::GetRHI();
 	GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
-	GraphicsPSOInit.PrimitiveType = PT_TriangleStrip;
+	GraphicsPSOInit.PrimitiveType = PT_TriangleList;
 	GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GTextureVertexDeclaration.VertexDeclarationRHI;
 	GraphicsPSOInit.BoundShaderState.VertexShaderRHI = GETSAFERHISHADER_VERTEX(*VertexShader);
 	GraphicsPSOInit.BoundShaderState.PixelShaderRHI = GETSAFERHISHADER_PIXEL(*PixelShader);
-	SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit);
 
+	//The pipeline state cache owns the state, we only keep the pointer to skip the lookup
+	Cached.PipelineState = PipelineStateCache::GetAndOrCreateGraphicsPipelineState(RHICmdList, GraphicsPSOInit, EApplyRendertargetOption::CheckApply);
+	Cached.PixelShader = *PixelShader;
+	for (int32 i = 0; i < NumTargets; ++i)
+		Cached.RenderTargetFormats[i] = RenderTargets[i]->GetFormat();
 
+	return Cached;
+}
 
-	PixelShader->SetOutputTexture(RHICmdList, TextureParameterSRV);
-	PixelShader->SetUniformBuffers(RHICmdList, ConstantParameters, VariableParameters);
+void FPixelShader::ExecutePixelShaderInternal(const TArray<FPixelShaderTarget>& Targets, const FPixelShaderVariableParameters& DrawVariableParameters)
+{
+	check(IsInRenderingThread());
 
-	// Draw a fullscreen quad that we can run our pixel shader on
-	FTextureVertex Vertices[4];
-	Vertices[0].Position = FVector4(-1.0f, 1.0f, 0, 1.0f);
-	Vertices[1].Position = FVector4(1.0f, 1.0f, 0, 1.0f);
-	Vertices[2].Position = FVector4(-1.0f, -1.0f, 0, 1.0f);
-	Vertices[3].Position = FVector4(1.0f, -1.0f, 0, 1.0f);
-	Vertices[0].UV = FVector2D(0, 0);
-	Vertices[1].UV = FVector2D(1, 0);
-	Vertices[2].UV = FVector2D(0, 1);
-	Vertices[3].UV = FVector2D(1, 1);
+	if (bIsUnloading) //If we are about to unload, so just clean up the SRVs and buffers :)
+	{
+		InputTextureSRVs.Empty();
+		ConstantParametersBuffer.SafeRelease();
+		VariableParametersBuffer.SafeRelease();
+		for (FCachedPipelineState& Cached : CachedPipelineStates)
+			Cached = FCachedPipelineState();
+		return;
+	}
 
-	DrawPrimitiveUP(RHICmdList, PT_TriangleStrip, 2, Vertices, sizeof(Vertices[0]));
+	FRHICommandListImmediate& RHICmdList = GRHICommandList.GetImmediateCommandList();
 
-	PixelShader->UnbindBuffers(RHICmdList);
+	//Gather the render targets and the views of their inputs
+	FTextureRenderTargetResource* TargetResources[MAX_PIXEL_SHADER_TARGETS];
+	FTextureRHIParamRef RenderTargets[MAX_PIXEL_SHADER_TARGETS];
+	FShaderResourceViewRHIRef InputSRVs[MAX_PIXEL_SHADER_TARGETS];
+	int32 NumTargets = 0;
 
-	// Resolve render target.
-	RHICmdList.CopyToResolveTarget(
-		CurrentRenderTarget->GetRenderTargetResource()->GetRenderTargetTexture(),
-		CurrentRenderTarget->GetRenderTargetResource()->TextureRHI,
-		false, FResolveParams());
+	for (const FPixelShaderTarget& Target : Targets)
+	{
+		FTextureRenderTargetResource* Resource = Target.RenderTarget->GetRenderTargetResource();
+		if (!Resource || !Target.InputTexture)
+			continue;
+
+		TargetResources[NumTargets] = Resource;
+		RenderTargets[NumTargets] = Resource->GetRenderTargetTexture();
+		InputSRVs[NumTargets] = GetInputTextureSRV(Target.InputTexture);
+		NumTargets++;
+	}
 
+	if (NumTargets == 0) {
+		bIsPixelShaderExecuting = false;
+		return;
+	}
+
+	//The uniform buffers live as long as this class, the variable one is only written if the parameters changed
+	if (!ConstantParametersBuffer)
+		ConstantParametersBuffer = FPixelShaderConstantParametersRef::CreateUniformBufferImmediate(ConstantParameters, UniformBuffer_MultiFrame);
+	if (!VariableParametersBuffer) {
+		VariableParametersBuffer = FPixelShaderVariableParametersRef::CreateUniformBufferImmediate(DrawVariableParameters, UniformBuffer_MultiFrame);
+		UploadedVariableParameters = DrawVariableParameters;
+	}
+	else if (FMemory::Memcmp(&UploadedVariableParameters, &DrawVariableParameters, sizeof(FPixelShaderVariableParameters)) != 0) {
+		VariableParametersBuffer.UpdateUniformBufferImmediate(DrawVariableParameters);
+		UploadedVariableParameters = DrawVariableParameters;
+	}
+
+	// This is where the magic happens
+	CurrentTexture = TargetResources[0]->GetRenderTargetTexture();
+	SetRenderTargets(RHICmdList, NumTargets, RenderTargets, FTextureRHIParamRef(), 0, nullptr);
+
+	FCachedPipelineState& Cached = GetPipelineState(RHICmdList, RenderTargets, NumTargets);
+	RHICmdList.SetGraphicsPipelineState(Cached.PipelineState);
+
+	Cached.PixelShader->SetInputTextures(RHICmdList, InputSRVs, NumTargets);
+	Cached.PixelShader->SetUniformBuffers(RHICmdList, ConstantParametersBuffer, VariableParametersBuffer);
+
+	// Draw a fullscreen triangle from the static vertex buffer that we can run our pixel shader on
+	RHICmdList.SetStreamSource(0, GFullscreenTriangleVertexBuffer.VertexBufferRHI, 0);
+	RHICmdList.DrawPrimitive(PT_TriangleList, 0, 1, 1);
+
+	Cached.PixelShader->UnbindBuffers(RHICmdList);
+
+	// Resolve render targets.
+	for (int32 i = 0; i < NumTargets; ++i)
+	{
+		RHICmdList.CopyToResolveTarget(
+			TargetResources[i]->GetRenderTargetTexture(),
+			TargetResources[i]->TextureRHI,
+			false, FResolveParams());
+	}
 
 	if (bSave) //Save to disk if we have a save request!
 	{
@@ -189,6 +228,13 @@ void FPixelShader::ExecutePixelShaderInternal()
 		SaveScreenshot(RHICmdList);
 	}
 
+	//Drop the views of input textures nobody else holds anymore (e.g. after the compute shader changed its problem size)
+	for (auto It = InputTextureSRVs.CreateIterator(); It; ++It)
+	{
+		if (It.Value().Texture->GetRefCount() == 1)
+			It.RemoveCurrent();
+	}
+
 	bIsPixelShaderExecuting = false;
 }
 
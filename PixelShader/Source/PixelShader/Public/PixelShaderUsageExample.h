@@ -26,6 +26,15 @@
 
 #include "Private/PixelShaderDeclaration.h"
 
+/************************************************************************/
+/* An input texture and the render target it is drawn into              */
+/************************************************************************/
+struct FPixelShaderTarget
+{
+	UTextureRenderTarget2D* RenderTarget;
+	FTexture2DRHIRef InputTexture;
+};
+
 /***************************************************************************/
 /* This class demonstrates how to use the pixel shader we have declared.   */
 /* Most importantly which RHI functions are needed to call and how to get  */
@@ -46,10 +55,18 @@ public:
 	/********************************************************************************************************/
 	void ExecutePixelShader(UTextureRenderTarget2D* RenderTarget, FTexture2DRHIRef InputTexture, FColor EndColor, float TextureParameterBlendFactor);
 
+	/************************************************************************/
+	/* Draws up to MAX_PIXEL_SHADER_TARGETS input textures into their       */
+	/* render targets with a single draw (multiple render targets), e.g.    */
+	/* the sorted point positions and colors. The render targets need the   */
+	/* same size.                                                           */
+	/************************************************************************/
+	void ExecutePixelShader(const TArray<FPixelShaderTarget>& Targets, FColor EndColor, float TextureParameterBlendFactor);
+
 	/************************************************************************/
 	/* Only execute this from the render thread!!!                          */
 	/************************************************************************/
-	void ExecutePixelShaderInternal();
+	void ExecutePixelShaderInternal(const TArray<FPixelShaderTarget>& Targets, const FPixelShaderVariableParameters& DrawVariableParameters);
 
 	/************************************************************************/
 	/* Save a screenshot of the target to the project saved folder          */
@@ -61,7 +78,6 @@ public:
 
 private:
 	bool bIsPixelShaderExecuting;
-	bool bMustRegenerateSRV;
 	bool bIsUnloading;
 	bool bSave;
 
@@ -69,13 +85,36 @@ private:
 	FPixelShaderVariableParameters VariableParameters;
 	ERHIFeatureLevel::Type FeatureLevel;
 
-	/** Main texture */
+	/** Created once and updated in place when the parameters change (render thread) */
+	FPixelShaderConstantParametersRef ConstantParametersBuffer;
+	FPixelShaderVariableParametersRef VariableParametersBuffer;
+	FPixelShaderVariableParameters UploadedVariableParameters;
+
+	/** The pipeline state of each number of render targets, rebuilt only if the render target formats change (render thread) */
+	struct FCachedPipelineState
+	{
+		FGraphicsPipelineState* PipelineState = nullptr;
+		FPixelShaderDeclaration* PixelShader = nullptr;
+		EPixelFormat RenderTargetFormats[MAX_PIXEL_SHADER_TARGETS] = {};
+	};
+
+	FCachedPipelineState CachedPipelineStates[MAX_PIXEL_SHADER_TARGETS];
+
+	FCachedPipelineState& GetPipelineState(FRHICommandList& RHICmdList, const FTextureRHIParamRef* RenderTargets, int32 NumTargets);
+
+	/** Main texture (the first render target of the last draw) */
 	FTexture2DRHIRef CurrentTexture;
-	FTexture2DRHIRef TextureParameter;
-	UTextureRenderTarget2D* CurrentRenderTarget = nullptr;
-	
-	/** Since we are only reading from the resource, we do not need a UAV; an SRV is sufficient */
-	FShaderResourceViewRHIRef TextureParameterSRV;
 
+	/** Since we are only reading from the resources, we do not need UAVs; SRVs are sufficient */
+	struct FInputTextureSRV
+	{
+		FTexture2DRHIRef Texture;
+		FShaderResourceViewRHIRef SRV;
+	};
+
+	/** One SRV per input texture, so inputs that alternate (e.g. double buffered textures) keep theirs (render thread) */
+	TMap<FRHITexture2D*, FInputTextureSRV> InputTextureSRVs;
+
+	FShaderResourceViewRHIRef GetInputTextureSRV(FTexture2DRHIRef InputTexture);
 	void SaveScreenshot(FRHICommandListImmediate& RHICmdList);
 };